@@ -1,14 +1,46 @@
 /**************************************************************************************************/
 
 // stdc++
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 // catch
 #define CATCH_CONFIG_MAIN
 #include "catch/catch.hpp"
 
+// zlib
+#include <zlib.h>
+
 // application
+#include "../headers/batch.hpp"
+#include "../headers/bezier_batch.hpp"
+#include "../headers/flat_forest.hpp"
 #include "../headers/forest_algorithms.hpp"
+#include "../headers/geometry.hpp"
+#include "../headers/layout.hpp"
+#include "../headers/mapped_file.hpp"
+#include "../headers/manifest.hpp"
+#include "../headers/number_format.hpp"
+#include "../headers/pool_allocator.hpp"
+#include "../headers/state.hpp"
+#include "../headers/write.hpp"
 
 /**************************************************************************************************/
 
@@ -43,8 +75,9 @@ SCENARIO("single node forest") {
 
 /**************************************************************************************************/
 
+template <typename Forest = forest<std::string>>
 auto big_test_forest() {
-    forest<std::string> f;
+    Forest f;
 
     auto a_iter = trailing_of(f.insert(f.end(), "A"));
 
@@ -302,3 +335,1693 @@ TEST_CASE("erase parents") {
 }
 
 /**************************************************************************************************/
+
+template <typename T>
+struct counting_allocator {
+    using value_type = T;
+
+    std::shared_ptr<std::ptrdiff_t> _live{std::make_shared<std::ptrdiff_t>(0)};
+
+    counting_allocator() = default;
+    template <typename U>
+    counting_allocator(const counting_allocator<U>& x) : _live{x._live} {}
+
+    T* allocate(std::size_t n) {
+        *_live += n;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n) {
+        *_live -= n;
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    friend bool operator==(const counting_allocator& a, const counting_allocator& b) {
+        return a._live == b._live;
+    }
+    friend bool operator!=(const counting_allocator& a, const counting_allocator& b) {
+        return !(a == b);
+    }
+};
+
+/**************************************************************************************************/
+
+TEST_CASE("custom allocator") {
+    using forest_t = forest<std::string, counting_allocator<std::string>>;
+    counting_allocator<std::string> allocator;
+
+    {
+        forest_t f{allocator};
+        f.push_back("A");
+        f.push_back("B");
+        REQUIRE(*allocator._live == 2);
+
+        auto g{std::move(f)};
+        REQUIRE(g.get_allocator() == allocator);
+        REQUIRE(*allocator._live == 2);
+
+        g.pop_front();
+        REQUIRE(*allocator._live == 1);
+    }
+
+    REQUIRE(*allocator._live == 0);
+}
+
+/**************************************************************************************************/
+
+TEST_CASE("node pool") {
+    fvg::detail::node_pool pool;
+
+    // An array first must not set the slot size; only a single object does.
+    void* array{pool.allocate(sizeof(int), alignof(int), 8)};
+    REQUIRE(pool.live() == 0);
+
+    void* a{pool.allocate(sizeof(int), alignof(int), 1)};
+    void* b{pool.allocate(sizeof(int), alignof(int), 1)};
+    REQUIRE(pool.live() == 2);
+    REQUIRE(static_cast<char*>(b) - static_cast<char*>(a) == sizeof(void*));
+
+    // Bigger than a slot: from the heap.
+    void* big{pool.allocate(64, alignof(int), 1)};
+    REQUIRE(pool.live() == 2);
+
+    pool.deallocate(big, 64, alignof(int), 1);
+    pool.deallocate(b, sizeof(int), alignof(int), 1);
+    pool.deallocate(a, sizeof(int), alignof(int), 1);
+    pool.deallocate(array, sizeof(int), alignof(int), 8);
+    REQUIRE(pool.live() == 0);
+
+    SECTION("through the allocator") {
+        fvg::pool_allocator<int> allocator;
+        int* p{allocator.allocate(8)};
+        int* q{allocator.allocate(1)};
+        int* r{allocator.allocate(1)};
+        REQUIRE(reinterpret_cast<char*>(r) - reinterpret_cast<char*>(q) == sizeof(void*));
+        allocator.deallocate(r, 1);
+        allocator.deallocate(q, 1);
+        allocator.deallocate(p, 8);
+    }
+}
+
+/**************************************************************************************************/
+
+TEST_CASE("pooled forest") {
+    using forest_t = fvg::pooled_forest<std::string>;
+    auto f{big_test_forest<forest_t>()};
+
+    SECTION("traversal") {
+        REQUIRE(to_string(f.begin(), f.end()) == "ABCFFGGHHCDIIJJKKDEEBA");
+        REQUIRE(to_string(preorder_range(f)) == "ABCFGHDIJKE");
+    }
+
+    SECTION("copy") {
+        forest_t g{f};
+        REQUIRE(g == f);
+        REQUIRE(g.get_allocator() != f.get_allocator());
+    }
+
+    SECTION("move") {
+        auto allocator{f.get_allocator()};
+        forest_t g{std::move(f)};
+        REQUIRE(f.empty());
+        REQUIRE(g.size() == 11);
+        REQUIRE(g.get_allocator() == allocator);
+
+        f = std::move(g);
+        REQUIRE(f.size() == 11);
+        REQUIRE(f.get_allocator() == allocator);
+    }
+
+    SECTION("erase and reuse") {
+        auto node{std::find_if(f.begin(), f.end(), [](auto& x){ return x == "D"; })};
+        f.erase(leading_of(node), std::next(trailing_of(node)));
+        REQUIRE(to_string(preorder_range(f)) == "ABCFGHE");
+
+        f.insert(trailing_of(f.begin()), "Z");
+        REQUIRE(to_string(preorder_range(f)) == "ABCFGHEZ");
+
+        f.clear();
+        REQUIRE(f.empty());
+
+        f.push_back("Y");
+        REQUIRE(to_string(preorder_range(f)) == "Y");
+    }
+
+    SECTION("transcribe") {
+        auto g{fvg::transcribe_forest(f, [](const auto& x){ return x.size(); })};
+        REQUIRE(g.size() == f.size());
+        REQUIRE(std::is_same_v<decltype(g), fvg::pooled_forest<std::size_t>>);
+    }
+}
+
+/**************************************************************************************************/
+
+TEST_CASE("flat forest") {
+    auto f{big_test_forest()};
+    auto flat{fvg::freeze(f)};
+
+    REQUIRE(flat.size() == f.size());
+
+    SECTION("empty") {
+        fvg::flat_forest<int> empty;
+        REQUIRE(empty.empty());
+        REQUIRE(empty.begin() == empty.end());
+        auto frozen{fvg::freeze(forest<int>())};
+        REQUIRE(frozen.empty());
+        REQUIRE(frozen.begin() == frozen.end());
+    }
+
+    SECTION("traversal") {
+        REQUIRE(to_string(flat.begin(), flat.end()) == "ABCFFGGHHCDIIJJKKDEEBA");
+        REQUIRE(to_string(preorder_range(flat)) == "ABCFGHDIJKE");
+        REQUIRE(to_string(postorder_range(flat)) == to_string(postorder_range(f)));
+        REQUIRE(to_string(flat.values()) == "ABCFGHDIJKE");
+
+        std::string reversed;
+        for (auto first{flat.end()}; first != flat.begin();) {
+            reversed += *--first;
+        }
+        REQUIRE(reversed == "ABEEDKKJJIIDCHHGGFFCBA");
+    }
+
+    SECTION("children") {
+        auto parent{std::find_if(flat.begin(), flat.end(), [](auto& x){ return x == "B"; })};
+        REQUIRE(to_string(child_range(parent)) == "CDE");
+        REQUIRE(has_children(parent));
+        REQUIRE(*find_parent(parent) == "A");
+        REQUIRE(*trailing_of(parent) == "B");
+        REQUIRE(is_trailing(trailing_of(parent)));
+        REQUIRE(to_string(child_range(flat.root())) == "A");
+
+        auto leaf{std::find_if(flat.begin(), flat.end(), [](auto& x){ return x == "J"; })};
+        REQUIRE(!has_children(leaf));
+        REQUIRE(*find_parent(leaf) == "D");
+    }
+
+    SECTION("depth") {
+        std::string expected;
+        for (auto first{depth_range(f).begin()}; first != depth_range(f).end(); ++first) {
+            expected += std::to_string(first.depth());
+        }
+
+        std::string result;
+        for (auto first{flat.begin()}; first != flat.end(); ++first) {
+            result += std::to_string(first.depth());
+        }
+
+        REQUIRE(result == expected);
+    }
+
+    SECTION("transcribe") {
+        auto sizes{fvg::transcribe_forest(flat, [](const auto& x){ return x.size(); })};
+        REQUIRE(sizes.shape() == flat.shape());
+        REQUIRE(sizes.size() == flat.size());
+
+        for (auto first{sizes.begin()}; first != sizes.end(); ++first) {
+            *first = first.index();
+        }
+        REQUIRE(sizes.values().back() == 10);
+    }
+}
+
+/**************************************************************************************************/
+
+template <typename Forest>
+void require_counts(const Forest& f) {
+    std::size_t size{0};
+
+    for (auto first{f.begin()}, last{f.end()}; first != last; ++first) {
+        if (!is_leading(first)) continue;
+
+        auto children{std::distance(child_begin(first), child_end(first))};
+        auto subtree{std::distance(typename Forest::const_preorder_iterator(first),
+                                   typename Forest::const_preorder_iterator(
+                                       std::next(trailing_of(first))))};
+
+        REQUIRE(f.child_count(first) == static_cast<std::size_t>(children));
+        REQUIRE(f.subtree_size(first) == static_cast<std::size_t>(subtree));
+        ++size;
+    }
+
+    REQUIRE(f.size() == size);
+    REQUIRE(f.subtree_size(f.root()) == size);
+    REQUIRE(f.child_count(f.root()) ==
+            static_cast<std::size_t>(std::distance(child_begin(f.root()), child_end(f.root()))));
+}
+
+/**************************************************************************************************/
+
+TEST_CASE("counted forest") {
+    using forest_t = forest<std::string, std::allocator<std::string>, true>;
+    auto f{big_test_forest<forest_t>()};
+    auto find{[](auto& f, const char* x){
+        return std::find_if(f.begin(), f.end(), [&](auto& y){ return y == x; });
+    }};
+
+    require_counts(f);
+    REQUIRE(f.child_count(find(f, "B")) == 3);
+    REQUIRE(f.subtree_size(find(f, "B")) == 10);
+
+    SECTION("uncounted agrees") {
+        auto g{big_test_forest()};
+        require_counts(g);
+    }
+
+    SECTION("insert") {
+        f.insert(find(f, "J"), "X");
+        f.insert(trailing_of(find(f, "E")), "Y");
+        f.push_back("Z");
+        require_counts(f);
+        REQUIRE(f.child_count(find(f, "E")) == 1);
+        REQUIRE(f.subtree_size(find(f, "A")) == 13);
+    }
+
+    SECTION("erase") {
+        f.erase(find(f, "J"));
+        require_counts(f);
+
+        f.erase(find(f, "C")); // its children move up into B
+        require_counts(f);
+        REQUIRE(f.child_count(find(f, "B")) == 5);
+
+        auto d{find(f, "D")};
+        f.erase(leading_of(d), std::next(trailing_of(d)));
+        require_counts(f);
+        REQUIRE(to_string(preorder_range(f)) == "ABFGHE");
+    }
+
+    SECTION("erase parents") {
+        erase_parents(f, find(f, "J"));
+        require_counts(f);
+        REQUIRE(f.child_count(f.root()) == 5);
+    }
+
+    SECTION("splice") {
+        auto g{big_test_forest<forest_t>()};
+        g.splice(trailing_of(find(g, "E")), f, find(f, "D"));
+        require_counts(f);
+        require_counts(g);
+        REQUIRE(f.size() == 7);
+        REQUIRE(g.size() == 15);
+
+        g.splice(g.end(), g, child_begin(find(g, "B")), child_end(find(g, "B")));
+        require_counts(g);
+        REQUIRE(g.child_count(g.root()) == 4);
+
+        f.splice(f.end(), g);
+        require_counts(f);
+        require_counts(g);
+        REQUIRE(g.empty());
+        REQUIRE(f.size() == 22);
+    }
+
+    SECTION("insert parent") {
+        auto b{find(f, "B")};
+        f.insert_parent(child_begin(b), std::next(child_begin(b), 2), "P");
+        require_counts(f);
+        REQUIRE(f.child_count(b) == 2);
+        REQUIRE(f.subtree_size(find(f, "P")) == 9);
+    }
+
+    SECTION("reverse") {
+        auto b{find(f, "B")};
+        f.reverse(child_begin(b), child_end(b));
+        require_counts(f);
+        REQUIRE(to_string(child_range(b)) == "EDC");
+    }
+
+    SECTION("copy, move, clear") {
+        forest_t g{f};
+        require_counts(g);
+
+        forest_t h{std::move(g)};
+        require_counts(g);
+        require_counts(h);
+        REQUIRE(h == f);
+
+        h.clear();
+        require_counts(h);
+        h.push_back("A");
+        require_counts(h);
+    }
+}
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+
+std::string format_number(double x, int precision, bool leading_zero = true) {
+    std::string result;
+    fvg::append_number(result, x, fvg::number_format{precision, leading_zero});
+    return result;
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+TEST_CASE("shortest numbers") {
+    constexpr auto shortest{fvg::number_format::shortest_k};
+
+    REQUIRE(format_number(0, shortest) == "0");
+    REQUIRE(format_number(-0.0, shortest) == "0");
+    REQUIRE(format_number(1, shortest) == "1");
+    REQUIRE(format_number(-125, shortest) == "-125");
+    REQUIRE(format_number(0.1, shortest) == "0.1");
+    REQUIRE(format_number(123.456, shortest) == "123.456");
+    REQUIRE(format_number(1e20, shortest) == "100000000000000000000");
+    REQUIRE(format_number(1e21, shortest) == "1e21");
+    REQUIRE(format_number(1e-6, shortest) == "0.000001");
+    REQUIRE(format_number(1.5e-7, shortest) == "1.5e-7");
+    REQUIRE(format_number(0.5, shortest, false) == ".5");
+    REQUIRE(format_number(-0.25, shortest, false) == "-.25");
+
+    SECTION("round trip at all magnitudes") {
+        std::mt19937_64 engine{42};
+
+        for (int i{0}; i != 10000; ++i) {
+            // Random bit patterns cover every exponent, subnormals included.
+            const auto bits{engine()};
+            double x;
+            std::memcpy(&x, &bits, sizeof(x));
+            if (!std::isfinite(x)) continue;
+
+            const auto text{format_number(x, shortest)};
+            REQUIRE(std::strtod(text.c_str(), nullptr) == x);
+        }
+
+        for (const auto x : {std::numeric_limits<double>::max(),
+                             std::numeric_limits<double>::min(),
+                             std::numeric_limits<double>::denorm_min()}) {
+            REQUIRE(std::strtod(format_number(x, shortest).c_str(), nullptr) == x);
+            REQUIRE(std::strtod(format_number(-x, shortest).c_str(), nullptr) == -x);
+        }
+    }
+}
+
+/**************************************************************************************************/
+
+TEST_CASE("fixed numbers") {
+    REQUIRE(format_number(2.5, 0) == "3");
+    REQUIRE(format_number(-2.4, 0) == "-2");
+    REQUIRE(format_number(125.0, 3) == "125");
+    REQUIRE(format_number(0.5, 3) == "0.5");
+    REQUIRE(format_number(1.25, 1) == "1.3");
+    REQUIRE(format_number(-0.0001, 3) == "0");
+    REQUIRE(format_number(-0.0, 3) == "0");
+    REQUIRE(format_number(0.123456789, 9) == "0.123456789");
+    REQUIRE(format_number(1e-9, 9) == "0.000000001");
+    REQUIRE(format_number(0.5, 3, false) == ".5");
+    REQUIRE(format_number(-0.25, 3, false) == "-.25");
+    REQUIRE(format_number(1.5, 3, false) == "1.5");
+
+    SECTION("every precision") {
+        for (int precision{0}; precision <= fvg::number_format::max_precision_k; ++precision) {
+            const auto text{format_number(3.14159265358979, precision)};
+            REQUIRE(text.size() == static_cast<std::size_t>(precision ? precision + 2 : 1));
+            REQUIRE(std::abs(std::strtod(text.c_str(), nullptr) - 3.14159265358979) <=
+                    0.5 / std::pow(10, precision));
+        }
+    }
+
+    SECTION("rounding carries") {
+        REQUIRE(format_number(0.9995, 3) == "1");
+        REQUIRE(format_number(9.9999, 3) == "10");
+        REQUIRE(format_number(-99.96, 1) == "-100");
+        REQUIRE(format_number(0.0996, 3) == "0.1");
+        REQUIRE(format_number(0.9995, 3, false) == "1");
+    }
+
+    SECTION("beyond exact integers") {
+        REQUIRE(format_number(1e17, 3) == "100000000000000000");
+    }
+}
+
+/**************************************************************************************************/
+
+TEST_CASE("non-finite numbers") {
+    for (const auto x : {std::numeric_limits<double>::infinity(),
+                         -std::numeric_limits<double>::infinity(),
+                         std::numeric_limits<double>::quiet_NaN()}) {
+        for (const auto precision : {fvg::number_format::shortest_k, 0, 3}) {
+            REQUIRE_THROWS_AS(format_number(x, precision), std::runtime_error);
+        }
+    }
+}
+
+/**************************************************************************************************/
+
+TEST_CASE("batch bezier kernels") {
+    INFO("instruction set: " << fvg::batch::instruction_set());
+
+    const fvg::cubic_bezier b{{10, 20}, {30, 120}, {90, -40}, {100, 50}};
+
+    // Counts either side of every vector width, so that each path and its scalar tail run.
+    for (const std::size_t n : {0, 1, 3, 7, 9, 17}) {
+        std::vector<double> t(n), x(n), y(n), dx(n), dy(n), s(n);
+
+        for (std::size_t i{0}; i != n; ++i) {
+            t[i] = n > 1 ? static_cast<double>(i) / (n - 1) : 0.5;
+        }
+
+        fvg::batch::evaluate(b, t.data(), n, x.data(), y.data());
+        fvg::batch::derivative(b, t.data(), n, dx.data(), dy.data());
+        fvg::batch::speed(b, t.data(), n, s.data());
+
+        for (std::size_t i{0}; i != n; ++i) {
+            const auto p{b(t[i])};
+            const auto d{b.derivative(t[i])};
+
+            REQUIRE(x[i] == Approx(p.x).margin(1e-9));
+            REQUIRE(y[i] == Approx(p.y).margin(1e-9));
+            REQUIRE(dx[i] == Approx(d.x).margin(1e-9));
+            REQUIRE(dy[i] == Approx(d.y).margin(1e-9));
+            REQUIRE(s[i] == Approx(d.magnitude()).margin(1e-9));
+        }
+    }
+
+    // Many curves at one parameter.
+    std::mt19937 engine{3};
+    std::uniform_real_distribution<double> coordinate{-100, 100};
+
+    for (const std::size_t n : {0, 1, 3, 7, 9, 17}) {
+        fvg::cubic_bezier_soa curves;
+        curves.reserve(n);
+
+        for (std::size_t i{0}; i != n; ++i) {
+            fvg::cubic_bezier c;
+            for (auto* p : {&c._s, &c._c1, &c._c2, &c._e}) {
+                *p = fvg::point{coordinate(engine), coordinate(engine)};
+            }
+            curves.push_back(c);
+            REQUIRE(curves[i] == c);
+        }
+
+        REQUIRE(curves.size() == n);
+
+        for (const auto t : {0., 0.25, 0.5, 1.}) {
+            std::vector<double> x(n), y(n), dx(n), dy(n);
+
+            fvg::batch::evaluate(curves, t, x.data(), y.data());
+            fvg::batch::derivative(curves, t, dx.data(), dy.data());
+
+            for (std::size_t i{0}; i != n; ++i) {
+                const auto p{curves[i](t)};
+                const auto d{curves[i].derivative(t)};
+
+                REQUIRE(x[i] == Approx(p.x).margin(1e-9));
+                REQUIRE(y[i] == Approx(p.y).margin(1e-9));
+                REQUIRE(dx[i] == Approx(d.x).margin(1e-9));
+                REQUIRE(dy[i] == Approx(d.y).margin(1e-9));
+            }
+        }
+    }
+}
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// The state `layout` should look like after its edits: its forest, less the root `live_layout`
+// adds for `with_root`, with the node properties given to `restyle`.
+fvg::state edited_state(const fvg::live_layout& layout,
+                        const fvg::state& original,
+                        const fvg::node_map& styles) {
+    fvg::state result;
+    result._names = layout.names();
+    result._n = styles;
+    result._e = original._e;
+    result._l = original._l;
+    result._s = original._s;
+
+    auto first{layout.forest().begin()};
+    auto last{layout.forest().end()};
+
+    if (original._s._with_root && first != last) {
+        ++first;
+        --last;
+    }
+
+    auto position{result._f.end()};
+
+    for (; first != last; ++first) {
+        if (is_leading(first)) {
+            position = trailing_of(result._f.insert(position, first->_name));
+        } else {
+            ++position;
+        }
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+// Makes `steps` random edits to a live layout of `json`, and after each one requires that it
+// draws exactly what rendering the edited state from scratch does.
+void require_live_edits(const std::string& json, int steps) {
+    const auto original{fvg::parse_state(json.data(), json.data() + json.size())};
+    const bool with_root{original._s._with_root};
+    const char* const names[]{"a", "b_1", "c", "x_y", "N_3"};
+
+    fvg::live_layout layout{original};
+    fvg::node_map styles{original._n};
+    std::mt19937 engine{7};
+
+    const auto pick{[&](std::size_t n) { return static_cast<std::size_t>(engine() % n); }};
+    const auto top_level{[&](const fvg::live_layout::iterator& i) {
+        return find_parent(i) == layout.end();
+    }};
+
+    const auto require_same{[&] {
+        std::string live;
+        layout.write(live);
+        REQUIRE(live == fvg::render_svg(edited_state(layout, original, styles)));
+    }};
+
+    require_same();
+
+    for (int step{0}; step != steps; ++step) {
+        std::vector<fvg::live_layout::iterator> nodes;
+
+        for (auto i{layout.begin()}; i != layout.end(); ++i) {
+            if (is_leading(i)) nodes.push_back(i);
+        }
+
+        // With a root, only its descendants are the document's; the root itself stays put.
+        std::vector<fvg::live_layout::iterator> editable;
+
+        for (const auto& i : nodes) {
+            if (!with_root || !top_level(i)) editable.push_back(i);
+        }
+
+        const auto edit{editable.empty() ? 0 : pick(4)};
+
+        INFO("step " << step << ", edit " << edit);
+
+        if (edit == 0) {
+            auto position{layout.end()};
+
+            if (!nodes.empty() && (with_root || pick(8))) {
+                const auto& n{nodes[pick(nodes.size())]};
+                position = (with_root && top_level(n)) || pick(2) ? trailing_of(n) : n;
+            }
+
+            layout.insert(position, names[pick(std::size(names))]);
+        } else if (edit == 1) {
+            auto n{editable[pick(editable.size())]};
+
+            // Mostly leaves, so that the forest doesn't empty out too quickly.
+            if (pick(3)) {
+                while (has_children(n)) ++n;
+            }
+
+            layout.erase(n);
+        } else if (edit == 2) {
+            layout.rename(editable[pick(editable.size())], names[pick(std::size(names))]);
+        } else {
+            const auto& n{nodes[pick(nodes.size())]};
+            fvg::node_properties properties;
+            properties._color = pick(2) ? "red" : "green";
+            properties._stroke_dasharray = "2";
+            styles[n->_name] = properties;
+            layout.restyle(n, std::move(properties));
+        }
+
+        require_same();
+    }
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+TEST_CASE("live layout") {
+    const std::string forest{R"("forest": ["a", ["b_1", "c", ["x_y"]], "N_3", ["a"]])"};
+    const std::string properties{R"("nodes": {"c": {"color": "red"}},
+                                    "edges": {"2": {"color": "green"}},
+                                    "edge_labels": ["1", "", "2", "", "3"])"};
+
+    SECTION("empty forest") {
+        require_live_edits(R"({"forest": []})", 300);
+    }
+
+    SECTION("widths") {
+        require_live_edits("{" + forest + ", " + properties + "}", 300);
+    }
+
+    SECTION("tidy") {
+        require_live_edits("{" + forest + R"(, "settings": {"layout": "tidy"}})", 300);
+    }
+
+    SECTION("with root") {
+        require_live_edits("{" + forest + ", " + properties +
+                               R"(, "settings": {"with_root": true, "with_root_top": true}})",
+                           300);
+    }
+
+    SECTION("empty forest with root") {
+        require_live_edits(R"({"forest": [], "settings": {"with_root": true}})", 300);
+    }
+}
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// An empty directory under the system's temporary one, for as long as the object lives.
+class temporary_directory {
+public:
+    explicit temporary_directory(const std::string& name) :
+        _path{std::filesystem::temp_directory_path() / ("fvg_test_" + name)} {
+        std::filesystem::remove_all(_path);
+        std::filesystem::create_directories(_path);
+    }
+
+    temporary_directory(const temporary_directory&) = delete;
+    temporary_directory& operator=(const temporary_directory&) = delete;
+
+    ~temporary_directory() {
+        std::error_code error;
+        std::filesystem::remove_all(_path, error);
+    }
+
+    const std::filesystem::path& path() const { return _path; }
+
+private:
+    std::filesystem::path _path;
+};
+
+void write_file(const std::filesystem::path& path, const std::string& contents) {
+    std::ofstream{path, std::ios::binary} << contents;
+}
+
+std::string read_file(const std::filesystem::path& path) {
+    std::ifstream input{path, std::ios::binary};
+    return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+TEST_CASE("incremental batch") {
+    const temporary_directory src{"incremental_src"};
+    const temporary_directory dst{"incremental_dst"};
+    const auto a_svg{dst.path() / "a.svg"};
+    const auto b_svg{dst.path() / "b.svg"};
+
+    write_file(src.path() / "a.json", R"({"forest": ["a", ["b"]]})");
+    write_file(src.path() / "b.json", R"({"forest": ["c"]})");
+
+    fvg::batch_options options;
+    options._incremental = true;
+
+    REQUIRE(fvg::render_directory(src.path(), dst.path(), options).empty());
+
+    const auto a{read_file(a_svg)};
+    const auto b{read_file(b_svg)};
+
+    // Stand-ins for the outputs, which only a render replaces.
+    write_file(a_svg, "stale");
+    write_file(b_svg, "stale");
+
+    SECTION("unchanged inputs are skipped") {
+        REQUIRE(fvg::render_directory(src.path(), dst.path(), options).empty());
+        REQUIRE(read_file(a_svg) == "stale");
+        REQUIRE(read_file(b_svg) == "stale");
+    }
+
+    SECTION("a changed input is rendered again") {
+        write_file(src.path() / "a.json", R"({"forest": ["a", ["b", "c"]]})");
+        REQUIRE(fvg::render_directory(src.path(), dst.path(), options).empty());
+        REQUIRE(read_file(a_svg) != "stale");
+        REQUIRE(read_file(a_svg) != a);
+        REQUIRE(read_file(b_svg) == "stale");
+    }
+
+    SECTION("other settings render everything again") {
+        options._write._svg._minify = true;
+        REQUIRE(fvg::render_directory(src.path(), dst.path(), options).empty());
+        REQUIRE(read_file(a_svg) != "stale");
+        REQUIRE(read_file(b_svg) != "stale");
+    }
+
+    SECTION("a batch that isn't incremental keeps the manifest current") {
+        auto minified{options};
+        minified._incremental = false;
+        minified._write._svg._minify = true;
+
+        REQUIRE(fvg::render_directory(src.path(), dst.path(), minified).empty());
+        REQUIRE(read_file(a_svg) != a);
+
+        REQUIRE(fvg::render_directory(src.path(), dst.path(), options).empty());
+        REQUIRE(read_file(a_svg) == a);
+        REQUIRE(read_file(b_svg) == b);
+    }
+
+    SECTION("the manifest is not an input") {
+        // Outputs next to the inputs are read back as (bad) inputs, but the manifest isn't.
+        fvg::render_directory(src.path(), src.path(), options);
+
+        for (const auto& error : fvg::render_directory(src.path(), src.path(), options)) {
+            REQUIRE(error._path.extension() == ".svg");
+        }
+    }
+}
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// The repository's sample documents.
+std::filesystem::path test_documents() {
+    return std::filesystem::path(__FILE__).parent_path().parent_path() / "test";
+}
+
+/**************************************************************************************************/
+// What a loader made of a document: a state, or the message it threw.
+struct loaded {
+    std::optional<fvg::state> _state;
+    std::string _error;
+};
+
+template <typename F>
+loaded load(F&& loader) {
+    loaded result;
+
+    try {
+        result._state = loader();
+    } catch (const std::exception& error) {
+        result._error = error.what();
+    }
+
+    return result;
+}
+
+loaded load_dom(const std::string& json) {
+    return load([&] { return fvg::make_state(fvg::parse_json(json)); });
+}
+
+loaded load_sax(const std::string& json) {
+    return load([&] { return fvg::parse_state(json.data(), json.data() + json.size()); });
+}
+
+/**************************************************************************************************/
+// Names are compared as strings; the two loaders needn't intern them in the same order.
+void require_same_state(const fvg::state& a, const fvg::state& b) {
+    std::vector<std::pair<bool, std::string>> a_forest;
+    std::vector<std::pair<bool, std::string>> b_forest;
+
+    for (auto i{a._f.begin()}; i != a._f.end(); ++i) {
+        a_forest.emplace_back(is_leading(i), a._names[*i]);
+    }
+
+    for (auto i{b._f.begin()}; i != b._f.end(); ++i) {
+        b_forest.emplace_back(is_leading(i), b._names[*i]);
+    }
+
+    REQUIRE(a_forest == b_forest);
+
+    for (std::size_t id{0}; id != a._names.size(); ++id) {
+        const auto& name{a._names[static_cast<fvg::name_id>(id)]};
+        const auto other{b._names.find(name)};
+        INFO("name: " << name);
+
+        // A name only one side interned has no properties there.
+        const auto& an{a._n[static_cast<fvg::name_id>(id)]};
+        const auto& bn{other || name.empty() ? b._n[other] : fvg::node_properties()};
+        REQUIRE(an._color == bn._color);
+        REQUIRE(an._stroke_dasharray == bn._stroke_dasharray);
+
+        const auto& ae{a._e[static_cast<fvg::name_id>(id)]};
+        const auto& be{other || name.empty() ? b._e[other] : fvg::edge_properties()};
+        REQUIRE(ae._hide == be._hide);
+        REQUIRE(ae._color == be._color);
+        REQUIRE(ae._t == be._t);
+        REQUIRE(ae._stroke_dasharray == be._stroke_dasharray);
+        REQUIRE(ae._label_offset == be._label_offset);
+        REQUIRE(ae._text_anchor == be._text_anchor);
+    }
+
+    REQUIRE(a._l.size() == b._l.size());
+
+    for (std::size_t i{0}; i != a._l.size(); ++i) {
+        REQUIRE(a._names[a._l[i]] == b._names[b._l[i]]);
+    }
+
+    REQUIRE(a._s._layout == b._s._layout);
+    REQUIRE(a._s._with_root == b._s._with_root);
+    REQUIRE(a._s._with_leaf_edges == b._s._with_leaf_edges);
+    REQUIRE(a._s._with_root_top == b._s._with_root_top);
+    REQUIRE(a._s._margin.l == b._s._margin.l);
+    REQUIRE(a._s._margin.t == b._s._margin.t);
+    REQUIRE(a._s._margin.r == b._s._margin.r);
+    REQUIRE(a._s._margin.b == b._s._margin.b);
+}
+
+// Both loaders accept `json` and make the same state of it, which draws the same.
+void require_same_load(const std::string& json) {
+    const auto dom{load_dom(json)};
+    const auto sax{load_sax(json)};
+
+    REQUIRE(dom._error == "");
+    REQUIRE(sax._error == "");
+    require_same_state(*dom._state, *sax._state);
+    REQUIRE(fvg::render_svg(*dom._state) == fvg::render_svg(*sax._state));
+}
+
+// Both loaders reject `json`, with `what` if it is given.
+void require_same_error(const std::string& json, const std::string& what = std::string()) {
+    const auto dom{load_dom(json)};
+    const auto sax{load_sax(json)};
+
+    REQUIRE(!dom._state);
+    REQUIRE(!sax._state);
+
+    if (!what.empty()) {
+        REQUIRE(dom._error == what);
+        REQUIRE(sax._error == what);
+    }
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+TEST_CASE("sax loader") {
+    SECTION("sample documents") {
+        std::size_t count{0};
+
+        for (const auto& entry : std::filesystem::directory_iterator{test_documents()}) {
+            if (entry.path().extension() != ".json") continue;
+            INFO(entry.path());
+            require_same_load(read_file(entry.path()));
+            ++count;
+        }
+
+        REQUIRE(count > 0);
+    }
+
+    SECTION("null sections and properties") {
+        require_same_load(R"({"forest": ["a"], "nodes": null, "edges": null,
+                              "edge_labels": null, "settings": null})");
+        require_same_load(R"({"forest": null})");
+        require_same_load(R"({"forest": ["a"], "nodes": {"a": {"color": null}},
+                              "edges": {"x": {"hide": null, "t": null}},
+                              "settings": {"with_root": null, "margin": null}})");
+    }
+
+    SECTION("repeated keys") {
+        require_same_load(R"({"forest": ["a"], "forest": ["b", ["c"]]})");
+        require_same_load(R"({"forest": ["a"], "nodes": {"a": {"color": "red", "color": "green"},
+                                                          "a": {"stroke-dasharray": "2"}}})");
+        require_same_load(R"({"settings": {"margin": 5, "margin": 7, "margin_left": 1}})");
+    }
+
+    SECTION("unknown keys") {
+        require_same_load(R"({"forest": ["a"], "extra": {"forest": [1, [2]]},
+                              "nodes": {"a": {"shape": ["circle"]}}})");
+    }
+
+    SECTION("margins") {
+        require_same_load(R"({"settings": {"margin": 5}})");
+        require_same_load(R"({"settings": {"margin": 5, "margin_width": 3, "margin_top": 2}})");
+        require_same_load(R"({"settings": {"margin_right": -4, "margin_bottom": 1e3}})");
+        require_same_load(R"({"settings": {"margin": "wide", "margin_height": true}})");
+        require_same_load(R"({"settings": {"margin": [1], "margin_left": {"x": 1}}})");
+    }
+
+    SECTION("errors") {
+        require_same_error(R"({"forest": [["a"]]})", "children missing parent definition");
+        require_same_error(R"({"forest": ["a", [1]]})",
+                           "unexpected node type; must be string or array");
+        require_same_error(R"({"forest": ["a"], "nodes": {"a": "red"}})",
+                           "dictionary expected for node property");
+        require_same_error(R"({"edges": {"x": 1}})", "dictionary expected for node property");
+        require_same_error(R"({"edge_labels": ["x", 2]})", "string expected for edge label");
+        require_same_error(R"({"settings": {"layout": "fancy"}})",
+                           "unknown layout; must be \"widths\" or \"tidy\"");
+
+        // Wrong value types; the messages are the loaders' own.
+        require_same_error(R"({"forest": ["a"], "nodes": {"a": {"color": 1}}})");
+        require_same_error(R"({"edges": {"x": {"hide": "yes"}}})");
+        require_same_error(R"({"settings": {"with_root": 1}})");
+        require_same_error(R"({"forest": {"a": 1}})");
+        require_same_error(R"({"nodes": ["a"]})");
+        require_same_error(R"({"forest": ["a"})");
+    }
+}
+
+/**************************************************************************************************/
+
+TEST_CASE("deep chain") {
+    // Deep enough to overflow the stack of anything that recursed once per level.
+    constexpr std::size_t depth_k{200'000};
+
+    std::string json{R"({"forest": )"};
+
+    for (std::size_t i{0}; i != depth_k; ++i) {
+        json += R"(["n", )";
+    }
+
+    json += "[]";
+    json.append(depth_k, ']');
+    json += '}';
+
+    auto state{fvg::parse_state(json.data(), json.data() + json.size())};
+    REQUIRE(state._f.size() == depth_k);
+    REQUIRE(fvg::make_state(fvg::parse_json(json))._f.size() == depth_k);
+
+    for (const auto style : {fvg::layout_style::widths, fvg::layout_style::tidy}) {
+        state._s._layout = style;
+
+        const auto layout{fvg::derive_layout(state._f, state._s)};
+        REQUIRE(layout._x.size() == depth_k);
+        REQUIRE(layout._x.front() == layout._x.back()); // a chain is one column
+        REQUIRE(layout._y.back() > layout._y.front());
+
+        const auto svg{fvg::render_svg(state)};
+        REQUIRE(svg.size() > depth_k);
+        REQUIRE(svg.compare(svg.size() - 7, 6, "</svg>") == 0);
+    }
+}
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// An element of a document, as far as the writer tests look at one.
+struct xml_element {
+    std::string _name;
+    std::map<std::string, std::string> _attributes;
+    std::string _text; // the character data inside it, that of nested elements included
+};
+
+bool is_name_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == ':' || c == '_' || c == '-';
+}
+
+// The elements of `document` in document order. Throws unless it is well-formed, as far as the
+// writer goes: one root, tags that nest, quoted attributes that aren't repeated, and no stray
+// '<' or '&'.
+std::vector<xml_element> parse_xml(std::string_view document) {
+    std::vector<xml_element> result;
+    std::vector<std::size_t> open;
+    std::size_t roots{0};
+    std::size_t i{0};
+
+    const auto fail = [&](const char* what) {
+        throw std::runtime_error(std::string(what) + " at " + std::to_string(i));
+    };
+
+    const auto name = [&] {
+        const auto first{i};
+        while (i != document.size() && is_name_char(document[i])) ++i;
+        if (i == first) fail("name expected");
+        return std::string(document.substr(first, i - first));
+    };
+
+    const auto space = [&] {
+        const auto first{i};
+        while (i != document.size() && std::isspace(static_cast<unsigned char>(document[i]))) ++i;
+        return i != first;
+    };
+
+    if (document.substr(0, 5) == "<?xml") {
+        i = document.find("?>");
+        if (i == std::string_view::npos) fail("unterminated declaration");
+        i += 2;
+    }
+
+    while (i != document.size()) {
+        if (document[i] != '<') {
+            const auto last{std::min(document.find('<', i), document.size())};
+            const auto text{document.substr(i, last - i)};
+
+            for (auto amp{text.find('&')}; amp != std::string_view::npos;
+                 amp = text.find('&', amp + 1)) {
+                const auto semicolon{text.find(';', amp)};
+                if (semicolon == std::string_view::npos || semicolon == amp + 1) {
+                    fail("stray '&'");
+                }
+            }
+
+            if (open.empty()) {
+                if (text.find_first_not_of(" \t\r\n") != std::string_view::npos) {
+                    fail("text outside the root");
+                }
+            }
+
+            for (const auto index : open) result[index]._text += text;
+
+            i = last;
+            continue;
+        }
+
+        ++i;
+
+        if (i != document.size() && document[i] == '/') {
+            ++i;
+            const auto closed{name()};
+            space();
+            if (open.empty() || result[open.back()]._name != closed) fail("mismatched end tag");
+            if (i == document.size() || document[i] != '>') fail("'>' expected");
+            ++i;
+            open.pop_back();
+            continue;
+        }
+
+        if (open.empty() && roots++) fail("second root");
+
+        xml_element element;
+        element._name = name();
+
+        while (true) {
+            const auto spaced{space()};
+            if (i == document.size()) fail("unterminated tag");
+
+            if (document.substr(i, 2) == "/>") {
+                i += 2;
+                result.push_back(std::move(element));
+                break;
+            }
+
+            if (document[i] == '>') {
+                ++i;
+                open.push_back(result.size());
+                result.push_back(std::move(element));
+                break;
+            }
+
+            if (!spaced) fail("space expected");
+
+            auto attribute{name()};
+            if (i == document.size() || document[i] != '=') fail("'=' expected");
+            ++i;
+
+            if (i == document.size() || (document[i] != '\'' && document[i] != '"')) {
+                fail("quote expected");
+            }
+
+            const auto close{document.find(document[i], i + 1)};
+            if (close == std::string_view::npos) fail("unterminated value");
+
+            const auto value{document.substr(i + 1, close - i - 1)};
+            if (value.find('<') != std::string_view::npos) fail("'<' in a value");
+            i = close + 1;
+
+            if (!element._attributes.emplace(std::move(attribute), value).second) {
+                fail("repeated attribute");
+            }
+        }
+    }
+
+    if (!open.empty()) fail("unclosed element");
+    if (roots != 1) fail("no root");
+
+    return result;
+}
+
+/**************************************************************************************************/
+// The numbers in path data, a point list or a transform, however they are separated.
+std::vector<double> numbers_in(const std::string& text) {
+    std::vector<double> result;
+
+    for (const char* p{text.c_str()}; *p;) {
+        if (std::isdigit(static_cast<unsigned char>(*p)) || *p == '-' || *p == '.') {
+            char* end{nullptr};
+            result.push_back(std::strtod(p, &end));
+            p = end;
+        } else {
+            ++p;
+        }
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+// One drawn thing, in absolute coordinates: a circle (cx, cy, r), rect (x, y, width, height),
+// line (x1, y1, x2, y2), curve (its path data), arrowhead (its three corners) or text (x, y; the
+// kind carries the label).
+using shape = std::pair<std::string, std::vector<double>>;
+
+// What `document` draws, however it was written. Edges and arrowheads may be coalesced, shapes
+// drawn through <use> and presentation moved into classes; none of that changes the shapes.
+std::vector<shape> geometry(const std::string& document) {
+    const auto elements{parse_xml(document)};
+    std::map<std::string, const xml_element*> defined;
+    std::vector<shape> result;
+
+    for (const auto& element : elements) {
+        const auto id{element._attributes.find("id")};
+        if (id != element._attributes.end()) defined.emplace(id->second, &element);
+    }
+
+    const auto number = [](const xml_element& element, const std::string& name) {
+        const auto found{element._attributes.find(name)};
+        REQUIRE(found != element._attributes.end());
+        return std::strtod(found->second.c_str(), nullptr);
+    };
+
+    const auto add = [&](const xml_element& element, double x, double y, const xml_element& look) {
+        if (look._name == "circle") {
+            result.push_back({"circle", {x, y, number(look, "r")}});
+        } else if (look._name == "rect") {
+            result.push_back({"rect", {x, y, number(look, "width"), number(look, "height")}});
+        } else {
+            FAIL("unexpected shape " << look._name << " for " << element._name);
+        }
+    };
+
+    for (const auto& element : elements) {
+        const auto& attributes{element._attributes};
+        const auto& name{element._name};
+
+        if (attributes.count("id")) continue; // drawn only where it is used
+
+        if (name == "circle") {
+            add(element, number(element, "cx"), number(element, "cy"), element);
+        } else if (name == "rect") {
+            add(element, number(element, "x"), number(element, "y"), element);
+        } else if (name == "line") {
+            result.push_back({"line",
+                              {number(element, "x1"), number(element, "y1"),
+                               number(element, "x2"), number(element, "y2")}});
+        } else if (name == "polygon") {
+            result.push_back({"arrowhead", numbers_in(attributes.at("points"))});
+        } else if (name == "path") {
+            // Subpaths start at an M; those of arrowheads are closed.
+            const auto& data{attributes.at("d")};
+
+            for (auto first{data.find('M')}; first != std::string::npos;) {
+                const auto last{data.find('M', first + 1)};
+                const auto subpath{data.substr(first, last - first)};
+                const bool closed{subpath.find('Z') != std::string::npos};
+                result.push_back({closed ? "arrowhead" : "curve", numbers_in(subpath)});
+                first = last;
+            }
+        } else if (name == "use") {
+            const auto& href{attributes.at("xlink:href")};
+            REQUIRE(href.front() == '#');
+            const auto& look{*defined.at(href.substr(1))};
+
+            if (look._name != "polygon") {
+                add(element, number(element, "x"), number(element, "y"), look);
+                continue;
+            }
+
+            // translate(x y) rotate(degrees) of the corners as defined.
+            const auto transform{numbers_in(attributes.at("transform"))};
+            REQUIRE(transform.size() == 3);
+            const auto angle{transform[2] * std::acos(-1.0) / 180};
+            const auto corners{numbers_in(look._attributes.at("points"))};
+            std::vector<double> placed;
+
+            for (std::size_t i{0}; i + 1 < corners.size(); i += 2) {
+                placed.push_back(transform[0] + corners[i] * std::cos(angle) -
+                                 corners[i + 1] * std::sin(angle));
+                placed.push_back(transform[1] + corners[i] * std::sin(angle) +
+                                 corners[i + 1] * std::cos(angle));
+            }
+
+            result.push_back({"arrowhead", std::move(placed)});
+        } else if (name == "text") {
+            const auto first{element._text.find_first_not_of(" \n")};
+            const auto last{element._text.find_last_not_of(" \n")};
+            const auto label{first == std::string::npos ?
+                                 std::string() :
+                                 element._text.substr(first, last - first + 1)};
+            result.push_back({"text " + label, {number(element, "x"), number(element, "y")}});
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+
+    return result;
+}
+
+// `a` and `b` draw the same shapes, to within the rounding of a rotated arrowhead.
+void require_same_geometry(const std::string& a, const std::string& b) {
+    const auto a_shapes{geometry(a)};
+    const auto b_shapes{geometry(b)};
+
+    REQUIRE(a_shapes.size() == b_shapes.size());
+
+    for (std::size_t i{0}; i != a_shapes.size(); ++i) {
+        INFO("shape " << i << ": " << a_shapes[i].first);
+        REQUIRE(a_shapes[i].first == b_shapes[i].first);
+        REQUIRE(a_shapes[i].second.size() == b_shapes[i].second.size());
+
+        for (std::size_t j{0}; j != a_shapes[i].second.size(); ++j) {
+            REQUIRE(a_shapes[i].second[j] == Approx(b_shapes[i].second[j]).margin(2e-3));
+        }
+    }
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+TEST_CASE("writer modes") {
+    const auto expected{std::filesystem::path(__FILE__).parent_path() / "expected"};
+
+    SECTION("the default output is unchanged") {
+        for (const auto name : {"sample", "child_iteration"}) {
+            INFO(name);
+            const auto json{read_file(test_documents() / (std::string(name) + ".json"))};
+            const auto state{fvg::parse_state(json.data(), json.data() + json.size())};
+            REQUIRE(fvg::render_svg(state) == read_file(expected / (std::string(name) + ".svg")));
+        }
+    }
+
+    SECTION("every mode draws the same") {
+        std::size_t count{0};
+
+        for (const auto& entry : std::filesystem::directory_iterator{test_documents()}) {
+            if (entry.path().extension() != ".json") continue;
+
+            const auto json{read_file(entry.path())};
+            const auto state{fvg::parse_state(json.data(), json.data() + json.size())};
+            const auto plain{fvg::render_svg(state)};
+
+            parse_xml(plain);
+
+            for (unsigned modes{1}; modes != 16; ++modes) {
+                fvg::write_options options;
+                options._svg._minify = modes & 1;
+                options._svg._shared_shapes = modes & 2;
+                options._svg._style_classes = modes & 4;
+                options._svg._coalesce_edges = modes & 8;
+
+                INFO(entry.path() << ", modes " << modes);
+                require_same_geometry(plain, fvg::render_svg(state, options));
+            }
+
+            ++count;
+        }
+
+        REQUIRE(count > 0);
+    }
+
+    SECTION("each mode does what it says") {
+        const auto json{read_file(test_documents() / "sample.json")};
+        const auto state{fvg::parse_state(json.data(), json.data() + json.size())};
+        const auto plain{fvg::render_svg(state)};
+        const auto count = [](const std::string& svg, const std::string& element) {
+            std::size_t result{0};
+            for (const auto& e : parse_xml(svg)) result += e._name == element;
+            return result;
+        };
+
+        fvg::write_options options;
+
+        options._svg._minify = true;
+        const auto minified{fvg::render_svg(state, options)};
+        REQUIRE(minified.size() < plain.size());
+        REQUIRE(minified.find('\n') == std::string::npos);
+        REQUIRE(minified.compare(0, 4, "<svg") == 0);
+
+        options._svg = fvg::svg::writer_options();
+        options._svg._shared_shapes = true;
+        const auto shared{fvg::render_svg(state, options)};
+        REQUIRE(count(shared, "defs") == 1);
+        REQUIRE(count(shared, "circle") == 1); // all of the circles look the same
+        REQUIRE(count(shared, "use") == count(plain, "circle") + count(plain, "rect") +
+                                            count(plain, "polygon"));
+
+        options._svg = fvg::svg::writer_options();
+        options._svg._style_classes = true;
+        const auto classed{fvg::render_svg(state, options)};
+        REQUIRE(count(classed, "style") == 1);
+        REQUIRE(classed.find(" stroke=") == std::string::npos);
+
+        options._svg = fvg::svg::writer_options();
+        options._svg._coalesce_edges = true;
+        const auto coalesced{fvg::render_svg(state, options)};
+        REQUIRE(count(coalesced, "polygon") == 0);
+        REQUIRE(count(coalesced, "path") < count(plain, "path"));
+    }
+
+    SECTION("malformed documents are caught") {
+        REQUIRE_THROWS(parse_xml("<svg><path></svg>"));
+        REQUIRE_THROWS(parse_xml("<svg x='1' x='2'/>"));
+        REQUIRE_THROWS(parse_xml("<svg x=1/>"));
+        REQUIRE_THROWS(parse_xml("<svg/><svg/>"));
+        REQUIRE_THROWS(parse_xml("<svg>a & b</svg>"));
+        REQUIRE_NOTHROW(parse_xml("<?xml version='1.0'?>\n<svg a='1'><g>&#x211C;</g></svg>\n"));
+    }
+}
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// The document a gzip file holds.
+std::string gunzip(const std::string& compressed) {
+    // 15 window bits, plus 16 to take a gzip header and trailer only.
+    z_stream z{};
+    REQUIRE(inflateInit2(&z, 15 + 16) == Z_OK);
+
+    std::string result;
+    std::string chunk(64 * 1024, '\0');
+    int status{Z_OK};
+
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+    z.avail_in = static_cast<uInt>(compressed.size());
+
+    while (status == Z_OK) {
+        z.next_out = reinterpret_cast<Bytef*>(chunk.data());
+        z.avail_out = static_cast<uInt>(chunk.size());
+        status = inflate(&z, Z_NO_FLUSH);
+        result.append(chunk.data(), chunk.size() - z.avail_out);
+    }
+
+    const auto trailing{z.avail_in};
+    inflateEnd(&z);
+
+    REQUIRE(status == Z_STREAM_END);
+    REQUIRE(trailing == 0);
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+TEST_CASE("gzip output") {
+    const temporary_directory dst{"gzip"};
+    const auto json{read_file(test_documents() / "sample.json")};
+    const auto state{fvg::parse_state(json.data(), json.data() + json.size())};
+    const auto svg{fvg::render_svg(state)};
+
+    SECTION("an .svgz inflates to the plain document") {
+        const auto path{dst.path() / "sample.svgz"};
+        fvg::write_svg(state, path);
+        REQUIRE(gunzip(read_file(path)) == svg);
+    }
+
+    SECTION("_gzip compresses whatever the extension") {
+        const auto path{dst.path() / "sample.svg"};
+        fvg::write_options options;
+        options._gzip = true;
+        fvg::write_document(path, svg, options);
+        REQUIRE(gunzip(read_file(path)) == svg);
+    }
+
+    SECTION("the level is honored") {
+        const auto compressed = [&](int level) {
+            fvg::write_options options;
+            options._gzip = true;
+            options._gzip_level = level;
+
+            const auto path{dst.path() / ("level" + std::to_string(level) + ".svg")};
+            fvg::write_document(path, svg, options);
+
+            auto result{read_file(path)};
+            REQUIRE(gunzip(result) == svg);
+            return result;
+        };
+
+        const auto stored{compressed(0)};
+        const auto fastest{compressed(1)};
+        const auto standard{compressed(6)};
+        const auto best{compressed(9)};
+
+        // Level 0 only stores, and the gzip header's XFL byte records 1 and 9.
+        REQUIRE(stored.size() > svg.size());
+        REQUIRE(fastest.size() < svg.size());
+        REQUIRE(best.size() <= fastest.size());
+        REQUIRE(fastest[8] == 4);
+        REQUIRE(standard[8] == 0);
+        REQUIRE(best[8] == 2);
+    }
+
+    SECTION("batches name their outputs .svgz") {
+        const temporary_directory src{"gzip_src"};
+        write_file(src.path() / "sample.json", json);
+
+        fvg::batch_options options;
+        options._write._gzip = true;
+        options._write._gzip_level = 9;
+
+        REQUIRE(fvg::render_directory(src.path(), dst.path(), options).empty());
+        REQUIRE(gunzip(read_file(dst.path() / "sample.svgz")) == svg);
+        REQUIRE(read_file(dst.path() / "sample.svgz")[8] == 2);
+    }
+}
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// What a batch left behind: every output by name, the manifest's entries sorted (it keeps them in
+// no particular order), and the errors it returned.
+struct batch_result {
+    std::map<std::string, std::string> _outputs;
+    std::vector<std::string> _manifest;
+    std::vector<std::pair<std::string, std::string>> _errors;
+};
+
+batch_result run_batch(const std::filesystem::path& srcdir,
+                       const std::filesystem::path& dstdir,
+                       const fvg::batch_options& options) {
+    batch_result result;
+
+    for (const auto& error : fvg::render_directory(srcdir, dstdir, options)) {
+        result._errors.emplace_back(error._path.filename().string(), error._what);
+    }
+
+    for (const auto& entry : std::filesystem::directory_iterator{dstdir}) {
+        const auto name{entry.path().filename().string()};
+
+        if (name == fvg::render_manifest::file_name_k) {
+            std::istringstream lines{read_file(entry.path())};
+            for (std::string line; std::getline(lines, line);) result._manifest.push_back(line);
+            std::sort(result._manifest.begin(), result._manifest.end());
+        } else {
+            result._outputs.emplace(name, read_file(entry.path()));
+        }
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+TEST_CASE("parallel batches") {
+    const temporary_directory src{"parallel_src"};
+    std::size_t count{0};
+
+    for (const auto& entry : std::filesystem::directory_iterator{test_documents()}) {
+        if (entry.path().extension() != ".json") continue;
+        std::filesystem::copy_file(entry.path(), src.path() / entry.path().filename());
+        ++count;
+    }
+
+    write_file(src.path() / "bad.json", R"({"forest": ["a", ["b"]], "nodes": 3})");
+
+    const temporary_directory sequential_dst{"parallel_sequential"};
+    const auto expected{run_batch(src.path(), sequential_dst.path(), fvg::batch_options())};
+
+    REQUIRE(expected._outputs.size() == count);
+    REQUIRE(expected._manifest.size() > count); // the header, too
+    REQUIRE(expected._errors.size() == 1);
+    REQUIRE(expected._errors.front().first == "bad.json");
+
+    struct lanes {
+        std::size_t _jobs;
+        std::size_t _pipeline_depth;
+    };
+
+    for (const auto [jobs, depth] : {lanes{4, 0}, lanes{0, 0}, lanes{1, 1}, lanes{1, 4},
+                                      lanes{3, 2}, lanes{0, 1}}) {
+        INFO("jobs " << jobs << ", pipeline depth " << depth);
+
+        fvg::batch_options options;
+        options._jobs = jobs;
+        options._pipeline_depth = depth;
+
+        const temporary_directory dst{"parallel_" + std::to_string(jobs) + "_" +
+                                      std::to_string(depth)};
+        const auto result{run_batch(src.path(), dst.path(), options)};
+
+        REQUIRE(result._errors == expected._errors);
+        REQUIRE(result._manifest == expected._manifest);
+        REQUIRE(result._outputs.size() == expected._outputs.size());
+
+        for (const auto& [name, output] : expected._outputs) {
+            INFO(name);
+            REQUIRE(result._outputs.count(name));
+            REQUIRE(result._outputs.at(name) == output);
+        }
+    }
+}
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// The length of `b` from 0 to `t`, summed over `n` chords: short of the true length by an amount
+// that falls with the square of the chord length, down to the rounding of the sum.
+double chord_length(const fvg::cubic_bezier& b, double t, std::size_t n) {
+    double result{0};
+    auto p{b(0)};
+
+    for (std::size_t i{1}; i <= n; ++i) {
+        const auto q{b(t * static_cast<double>(i) / static_cast<double>(n))};
+        result += (q - p).magnitude();
+        p = q;
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+TEST_CASE("adaptive arc length") {
+    SECTION("length and find are within the tolerance") {
+        std::mt19937 engine{42};
+        std::uniform_real_distribution<double> coordinate{0, 200};
+        const auto random_point = [&] {
+            return fvg::point{coordinate(engine), coordinate(engine)};
+        };
+
+        for (int i{0}; i != 50; ++i) {
+            const fvg::cubic_bezier b{random_point(), random_point(), random_point(),
+                                      random_point()};
+            const auto reference{chord_length(b, 1, 1 << 18)};
+
+            for (const auto tolerance : {1., .1, .01, .001}) {
+                INFO("curve " << i << ", tolerance " << tolerance);
+
+                const fvg::alp a{b, tolerance};
+                REQUIRE(std::abs(a.length() - reference) <= tolerance / 2);
+
+                double last_t{0};
+
+                for (int k{1}; k != 10; ++k) {
+                    const auto u{a.length() * k / 10};
+                    const auto t{a.find(u)};
+
+                    REQUIRE(t >= last_t);
+                    REQUIRE(std::abs(chord_length(b, t, 1 << 14) - u) <= tolerance);
+                    last_t = t;
+                }
+            }
+        }
+    }
+
+    SECTION("a near-cusp curve") {
+        // The speed all but vanishes at t = 1/3. The piece around it never gets flat enough for
+        // a tolerance this small, so the subdivision there stops at the depth limit instead;
+        // what that piece leaves out is far below the tolerance anyway.
+        const fvg::cubic_bezier b{{0, 0}, {10, 10}, {10, 0}, {-30, 1e-9}};
+        const auto reference{chord_length(b, 1, 1 << 21)};
+
+        for (const auto tolerance : {1e-3, 1e-6, 1e-9}) {
+            INFO("tolerance " << tolerance);
+
+            const fvg::alp a{b, tolerance};
+            REQUIRE(std::abs(a.length() - reference) <= tolerance / 2);
+
+            // Either side of the cusp, and right on it.
+            const auto cusp{chord_length(b, 1. / 3, 1 << 20)};
+
+            for (const auto u : {cusp / 2, cusp, (cusp + a.length()) / 2}) {
+                const auto t{a.find(u)};
+                REQUIRE(std::abs(chord_length(b, t, 1 << 20) - u) <= tolerance);
+            }
+        }
+    }
+}
+
+/**************************************************************************************************/
+
+TEST_CASE("mapped file") {
+    const temporary_directory directory{"mapped_file"};
+    const auto path{directory.path() / "input"};
+    const auto contents = [](const fvg::mapped_file& file) {
+        return std::string(file.begin(), file.end());
+    };
+
+    SECTION("both ways read the whole file") {
+        // Several read() chunks long, and not a multiple of the page size.
+        std::string bytes(300'001, '\0');
+        std::mt19937 engine{9};
+        for (auto& c : bytes) c = static_cast<char>(engine());
+        write_file(path, bytes);
+
+        for (const auto access : {fvg::file_access::map, fvg::file_access::copy}) {
+            const fvg::mapped_file file{path, access};
+            REQUIRE(file.size() == bytes.size());
+            REQUIRE(contents(file) == bytes);
+        }
+    }
+
+    SECTION("empty and missing files are empty") {
+        write_file(path, "");
+
+        for (const auto access : {fvg::file_access::map, fvg::file_access::copy}) {
+            const fvg::mapped_file empty{path, access};
+            REQUIRE(empty.empty());
+            REQUIRE(empty.begin() == empty.end());
+
+            const fvg::mapped_file missing{directory.path() / "missing", access};
+            REQUIRE(missing.empty());
+        }
+    }
+
+    SECTION("a file that opens but can't be read throws") {
+        for (const auto access : {fvg::file_access::map, fvg::file_access::copy}) {
+            REQUIRE_THROWS_AS(fvg::mapped_file(directory.path(), access), std::runtime_error);
+        }
+    }
+
+#if defined(__linux__)
+    SECTION("only a mapping sees the file change under it") {
+        write_file(path, "before");
+
+        const fvg::mapped_file mapped{path, fvg::file_access::map};
+        const fvg::mapped_file copied{path, fvg::file_access::copy};
+
+        // Rewritten in place; truncating it would fault the mapping.
+        std::fstream{path, std::ios::in | std::ios::out | std::ios::binary} << "after!";
+
+        REQUIRE(contents(mapped) == "after!");
+        REQUIRE(contents(copied) == "before");
+    }
+#endif
+}
+
+/**************************************************************************************************/
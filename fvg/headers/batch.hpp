@@ -0,0 +1,84 @@
+/**************************************************************************************************/
+
+#ifndef FORESTVG_BATCH_HPP
+#define FORESTVG_BATCH_HPP
+
+/**************************************************************************************************/
+
+// stdc++
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// application
+#include "mapped_file.hpp"
+#include "write.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+struct batch_options {
+    // How many files to render at once. 1 renders on the calling thread; 0 means one job per
+    // hardware thread. Jobs run on stlab::default_executor, so more jobs than that pool has
+    // threads will not run any faster.
+    std::size_t _jobs{1};
+
+    // Non-zero renders through a pipeline instead: each of the `_jobs` lanes reads, parses,
+    // renders and writes four files at once, one per stage, and lets a stage run at most this
+    // many files ahead of the next.
+    std::size_t _pipeline_depth{0};
+
+    // Skips the inputs whose contents, and the options, are the same as when their output was
+    // rendered, going by the `render_manifest` kept in the output directory.
+    bool _incremental{false};
+
+    // How the inputs are read; `file_access::copy` if they may be written to during the batch.
+    file_access _access{file_access::map};
+
+    write_options _write;
+};
+
+struct batch_error {
+    std::filesystem::path _path;
+    std::string _what;
+};
+
+/**************************************************************************************************/
+// Where a batch writes the output of `src`.
+std::filesystem::path output_path(const std::filesystem::path& dstdir,
+                                  const std::filesystem::path& src,
+                                  const write_options& options);
+
+// Renders one file of a batch. Returns an empty string on success, otherwise what went wrong.
+// `hash`, if given, gets the `content_hash` of the input as it was read.
+std::string render_file(const std::filesystem::path& src,
+                        const std::filesystem::path& dst,
+                        const write_options& options,
+                        file_access access = file_access::map,
+                        std::uint64_t* hash = nullptr);
+
+// Everything besides the input that the output depends on, as kept in a `render_manifest`.
+std::uint64_t settings_hash(const write_options& options);
+
+/**************************************************************************************************/
+// Renders every regular file in `srcdir` into `dstdir` (same stem, .svg extension, or .svgz with
+// `write_options::_gzip`). A file that fails does not stop the others; the failures are returned,
+// ordered by path. Every run, incremental or not, leaves the `render_manifest` in `dstdir`
+// describing the outputs it wrote, so a later incremental run knows what they were made from.
+std::vector<batch_error> render_directory(const std::filesystem::path& srcdir,
+                                          const std::filesystem::path& dstdir,
+                                          const batch_options& options);
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
+
+#endif // FORESTVG_BATCH_HPP
+
+/**************************************************************************************************/
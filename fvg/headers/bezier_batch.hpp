@@ -0,0 +1,66 @@
+/**************************************************************************************************/
+
+#ifndef FORESTVG_BEZIER_BATCH_HPP
+#define FORESTVG_BEZIER_BATCH_HPP
+
+/**************************************************************************************************/
+
+// stdc++
+#include <cstddef>
+#include <vector>
+
+// application
+#include "geometry.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+// Many curves, one array per coordinate, so that a batch kernel can load the same control point
+// of consecutive curves as one vector.
+struct cubic_bezier_soa {
+    std::vector<double> _sx, _sy;
+    std::vector<double> _c1x, _c1y;
+    std::vector<double> _c2x, _c2y;
+    std::vector<double> _ex, _ey;
+
+    std::size_t size() const { return _sx.size(); }
+    void reserve(std::size_t n);
+    void push_back(const cubic_bezier& b);
+    cubic_bezier operator[](std::size_t i) const;
+};
+
+/**************************************************************************************************/
+/*
+    Batch evaluation of cubic beziers, either many parameters on one curve or one parameter on
+    many curves. Results go to caller-provided arrays of at least `n` (or `curves.size()`)
+    doubles; the inputs and outputs may not overlap.
+
+    The kernels are written once against a small vector abstraction and instantiated for AVX2
+    (4 lanes) when the compiler targets it, else SSE2 (2 lanes), else plain scalar code. Define
+    FORESTVG_NO_SIMD to force the scalar version.
+*/
+namespace batch {
+
+void evaluate(const cubic_bezier& b, const double* t, std::size_t n, double* x, double* y);
+void derivative(const cubic_bezier& b, const double* t, std::size_t n, double* x, double* y);
+void speed(const cubic_bezier& b, const double* t, std::size_t n, double* s); // |B'(t)|
+
+void evaluate(const cubic_bezier_soa& curves, double t, double* x, double* y);
+void derivative(const cubic_bezier_soa& curves, double t, double* x, double* y);
+
+// "avx2", "sse2" or "scalar": the instruction set the kernels were built for.
+const char* instruction_set();
+
+} // namespace batch
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
+
+#endif // FORESTVG_BEZIER_BATCH_HPP
+
+/**************************************************************************************************/
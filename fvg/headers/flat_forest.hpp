@@ -0,0 +1,267 @@
+/**************************************************************************************************/
+
+#ifndef FORESTVG_FLAT_FOREST_HPP
+#define FORESTVG_FLAT_FOREST_HPP
+
+/**************************************************************************************************/
+
+// stdc++
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// stlab
+#include <stlab/forest.hpp>
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+template <typename T>
+class flat_forest;
+
+/**************************************************************************************************/
+
+namespace detail {
+
+/**************************************************************************************************/
+// One entry per edge, in fullorder. The root's leading and trailing edges bracket the array, the
+// same way the tail node brackets a stlab::forest, so `root()`, `child_begin(root())`, etc. work.
+struct flat_edge {
+    static constexpr std::uint32_t root_index_k{std::numeric_limits<std::uint32_t>::max()};
+
+    std::uint32_t _index; // into the value array; the node's preorder position
+    std::int32_t _mate;   // offset from this edge to the other edge of the same node
+    std::int32_t _depth;  // top-level nodes are at depth 0; the root is at -1
+    stlab::forest_edge _edge;
+};
+
+using flat_shape = std::vector<flat_edge>;
+
+/**************************************************************************************************/
+/*
+    Models FullorderIterator. The edge is held by the iterator (so `leading_of`, `pivot` and
+    friends can assign to it as they do with a forest iterator) and the entry pointer is only
+    moved to the mate entry when the two disagree.
+*/
+template <typename T> // T is value_type, possibly const-qualified
+struct flat_forest_iterator {
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using pointer = T*;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    flat_forest_iterator() = default;
+
+    template <typename U>
+    flat_forest_iterator(const flat_forest_iterator<U>& x) :
+        _e{x._e}, _values{x._values}, _edge{x._edge} {}
+
+    stlab::forest_edge edge() const { return _edge; }
+    stlab::forest_edge& edge() { return _edge; }
+
+    bool equal_node(const flat_forest_iterator& y) const { return _e->_index == y._e->_index; }
+
+    difference_type depth() const { return _e->_depth; }
+
+    // The preorder position of the node, suitable for indexing parallel arrays.
+    std::size_t index() const { return _e->_index; }
+
+    reference operator*() const { return _values[_e->_index]; }
+    pointer operator->() const { return &_values[_e->_index]; }
+    auto& operator++() {
+        const auto* e{entry()};
+        // Like the tail of a stlab::forest, stepping off the root's trailing edge wraps around to
+        // its leading edge (and vice versa below).
+        _e = is_root(e) && stlab::is_trailing(e->_edge) ? e + e->_mate : e + 1;
+        _edge = _e->_edge;
+        return *this;
+    }
+    auto operator++(int) {
+        auto result{*this};
+        ++*this;
+        return result;
+    }
+    auto& operator--() {
+        const auto* e{entry()};
+        _e = is_root(e) && stlab::is_leading(e->_edge) ? e + e->_mate : e - 1;
+        _edge = _e->_edge;
+        return *this;
+    }
+    auto operator--(int) {
+        auto result{*this};
+        --*this;
+        return result;
+    }
+
+    friend bool operator==(const flat_forest_iterator& a, const flat_forest_iterator& b) {
+        return a.entry() == b.entry();
+    }
+    friend bool operator!=(const flat_forest_iterator& a, const flat_forest_iterator& b) {
+        return !(a == b);
+    }
+
+private:
+    template <typename>
+    friend class fvg::flat_forest;
+    template <typename>
+    friend struct flat_forest_iterator;
+
+    flat_forest_iterator(const flat_edge* e, T* values) :
+        _e{e}, _values{values}, _edge{e->_edge} {}
+
+    const flat_edge* entry() const { return _edge == _e->_edge ? _e : _e + _e->_mate; }
+
+    static bool is_root(const flat_edge* e) { return e->_index == flat_edge::root_index_k; }
+
+    const flat_edge* _e{nullptr};
+    T* _values{nullptr};
+    stlab::forest_edge _edge{stlab::forest_edge::leading};
+};
+
+/**************************************************************************************************/
+
+} // namespace detail
+
+/**************************************************************************************************/
+/*
+    A read-only (in shape; values may still be written) snapshot of a forest, laid out as one
+    contiguous fullorder array of edges plus one contiguous preorder array of values. Traversal
+    is a linear scan, moving to the other edge of a node is a single offset, and every edge knows
+    its depth. Forests of the same shape share their edge array, so deriving one flat forest from
+    another (see `transcribe_forest`) only allocates the values.
+*/
+template <typename T>
+class flat_forest {
+public:
+    using value_type = T;
+    using reference = T&;
+    using const_reference = const T&;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using iterator = detail::flat_forest_iterator<T>;
+    using const_iterator = detail::flat_forest_iterator<const T>;
+
+    flat_forest() : flat_forest(empty_shape(), {}) {}
+
+    flat_forest(std::shared_ptr<const detail::flat_shape> shape, std::vector<T> values) :
+        _shape{std::move(shape)}, _values{std::move(values)} {
+        assert(_shape->size() == _values.size() * 2 + 2);
+    }
+
+    size_type size() const { return _values.size(); }
+    bool empty() const { return _values.empty(); }
+
+    iterator root() { return iterator(_shape->data(), _values.data()); }
+    const_iterator root() const { return const_iterator(_shape->data(), _values.data()); }
+
+    iterator begin() { return std::next(root()); }
+    iterator end() { return stlab::trailing_of(root()); }
+    const_iterator begin() const { return std::next(root()); }
+    const_iterator end() const { return stlab::trailing_of(root()); }
+
+    // Values in preorder; `iterator::index()` indexes into this.
+    const std::vector<T>& values() const { return _values; }
+    std::vector<T>& values() { return _values; }
+
+    const std::shared_ptr<const detail::flat_shape>& shape() const { return _shape; }
+
+private:
+    static std::shared_ptr<const detail::flat_shape> empty_shape() {
+        static const auto result{std::make_shared<const detail::flat_shape>(detail::flat_shape{
+            {detail::flat_edge::root_index_k, 1, -1, stlab::forest_edge::leading},
+            {detail::flat_edge::root_index_k, -1, -1, stlab::forest_edge::trailing},
+        })};
+        return result;
+    }
+
+    std::shared_ptr<const detail::flat_shape> _shape;
+    std::vector<T> _values;
+};
+
+/**************************************************************************************************/
+// Compiles the fullorder range [first, last) into a flat forest. Iterative; runs in linear time
+// regardless of the depth of the forest.
+template <typename I, // I models FullorderIterator
+          typename P> // P models UnaryFunction of reference(I)
+auto freeze(I first, I last, P&& proj) {
+    using value_type = std::decay_t<decltype(proj(*first))>;
+    using detail::flat_edge;
+
+    auto shape{std::make_shared<detail::flat_shape>()};
+    std::vector<value_type> values;
+    std::vector<std::size_t> open{0}; // positions of the leading edges we are inside of
+
+    shape->push_back({flat_edge::root_index_k, 0, -1, stlab::forest_edge::leading});
+
+    while (first != last) {
+        const auto depth{static_cast<std::int32_t>(open.size() - 1)};
+
+        if (stlab::is_leading(first)) {
+            assert(values.size() < flat_edge::root_index_k);
+            open.push_back(shape->size());
+            shape->push_back({static_cast<std::uint32_t>(values.size()), 0, depth,
+                              stlab::forest_edge::leading});
+            values.push_back(proj(*first));
+        } else {
+            auto& leading{(*shape)[open.back()]};
+            const auto mate{static_cast<std::int32_t>(shape->size() - open.back())};
+            open.pop_back();
+            leading._mate = mate;
+            shape->push_back({leading._index, -mate, depth - 1, stlab::forest_edge::trailing});
+        }
+
+        ++first;
+    }
+
+    assert(open.size() == 1);
+
+    const auto mate{static_cast<std::int32_t>(shape->size())};
+    shape->front()._mate = mate;
+    shape->push_back({flat_edge::root_index_k, -mate, -1, stlab::forest_edge::trailing});
+
+    return flat_forest<value_type>(std::move(shape), std::move(values));
+}
+
+template <typename T, typename A>
+auto freeze(const stlab::forest<T, A>& f) {
+    return freeze(f.begin(), f.end(), [](const T& x) { return x; });
+}
+
+template <typename T, typename A>
+auto freeze(stlab::forest<T, A>&& f) {
+    auto result{freeze(f.begin(), f.end(), [](T& x) { return std::move(x); })};
+    f.clear();
+    return result;
+}
+
+/**************************************************************************************************/
+// Same shape, projected values. The edge array is shared, not copied.
+template <typename T,
+          typename P,
+          typename U = std::decay_t<decltype(std::declval<P>()(std::declval<const T&>()))>>
+flat_forest<U> transcribe_forest(const flat_forest<T>& f, P&& proj) {
+    std::vector<U> values;
+    values.reserve(f.size());
+
+    for (const auto& x : f.values()) {
+        values.push_back(proj(x));
+    }
+
+    return flat_forest<U>(f.shape(), std::move(values));
+}
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
+
+#endif // FORESTVG_FLAT_FOREST_HPP
+
+/**************************************************************************************************/
@@ -17,8 +17,8 @@ namespace fvg {
 
 /**************************************************************************************************/
 
-template <typename T>
-void print(const stlab::forest<T>& f) {
+template <typename T, typename A>
+void print(const stlab::forest<T, A>& f) {
     auto first{f.begin()};
     auto last{f.end()};
     std::size_t depth{0};
@@ -44,9 +44,14 @@ void print(const stlab::forest<T>& f) {
 
 /**************************************************************************************************/
 
-template <typename T, typename P, typename U = decltype(std::declval<P>()(T()))>
-stlab::forest<U> transcribe_forest(const stlab::forest<T>& f, P&& proj) {
-    stlab::forest<U> result;
+template <typename T,
+          typename A,
+          typename P,
+          typename U = decltype(std::declval<P>()(T())),
+          typename R =
+              stlab::forest<U, typename std::allocator_traits<A>::template rebind_alloc<U>>>
+R transcribe_forest(const stlab::forest<T, A>& f, P&& proj) {
+    R result;
     auto pos{result.root()};
     auto first{f.begin()};
     const auto last{f.end()};
@@ -83,12 +88,12 @@ I2 transform_forest(I1 first, I1 last, I2 out, P&& proj) {
 
 /**************************************************************************************************/
 // REVISIT: More closely model this after back_insert_iterator?
-template <typename T>
+template <typename T, typename A = std::allocator<T>>
 struct forest_inserter {
-    stlab::forest<T>& _f;
-    typename stlab::forest<T>::iterator _p;
+    stlab::forest<T, A>& _f;
+    typename stlab::forest<T, A>::iterator _p;
 
-    explicit forest_inserter(stlab::forest<T>& f) : _f{f}, _p{_f.root()} {}
+    explicit forest_inserter(stlab::forest<T, A>& f) : _f{f}, _p{_f.root()} {}
 
     forest_inserter& operator++() { ++_p; return *this; }
 
@@ -8,6 +8,8 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <utility>
+#include <vector>
 
 /**************************************************************************************************/
 
@@ -98,25 +100,52 @@ inline constexpr auto operator==(const cubic_bezier& a, const cubic_bezier& b) {
 inline constexpr auto operator!=(const cubic_bezier& a, const cubic_bezier& b) { return !(a == b); }
 
 /**************************************************************************************************/
-// arc-length parameterization
+/*
+    arc-length parameterization, in one of two modes:
+
+    - fixed (tolerance 0): the curve is split into equal spans of t, each span's length is found
+      by Gauss-Legendre quadrature of the curve's speed, and `find` inverts the running length by
+      Newton's method (bisection as a fallback) within the span that contains it. Constant work
+      per curve, and very accurate for the gentle curves fvg draws.
+
+    - adaptive (tolerance > 0, in output units): the curve is subdivided until each piece is flat
+      enough that its length is known to within its share of the tolerance (a piece's length lies
+      between its chord and its control polygon), so `length` is within half the tolerance of the
+      true length. `find` then bisects the piece holding `u` until what's left is shorter than the
+      tolerance, so the point at the returned t is within about the tolerance of the true one.
+      Short or nearly straight curves take a piece or two; long, bendy ones take what they need.
+*/
 struct alp {
-    explicit alp(cubic_bezier b) : _b(std::move(b)) {
-        compute_arc_table();
-    }
+    explicit alp(const cubic_bezier& b, double tolerance = 0);
 
-    double length() const { return _l.back(); }
+    double length() const { return _length; }
 
+    // The parameter at which the curve reaches length `u`, clamped to [0, 1].
     double find(double u) const;
     double rfind(double u) const { return find(length() - u); }
 
 private:
-    static constexpr auto sz_k{128};
-
-    void compute_arc_table();
-
-    const cubic_bezier _b;
-    std::array<point, sz_k> _a; // points
-    std::array<double, sz_k> _l; // accumulated lengths
+    static constexpr std::size_t spans_k{16};
+
+    struct piece {
+        cubic_bezier _b;
+        double _t0; // where the piece starts and ends on the whole curve
+        double _t1;
+        double _l0; // length of the curve before the piece
+    };
+
+    void build_fixed();
+    void build_adaptive();
+    double find_fixed(double u) const;
+    double find_adaptive(double u) const;
+
+    double length(double t0, double t1) const;
+
+    cubic_bezier _b;
+    double _tolerance;
+    double _length{0};
+    std::array<double, spans_k + 1> _l; // fixed: accumulated lengths at t = i / spans_k
+    std::vector<piece> _pieces;         // adaptive: in order along the curve
 };
 
 /**************************************************************************************************/
@@ -0,0 +1,68 @@
+/**************************************************************************************************/
+
+#ifndef FORESTVG_LAYOUT_HPP
+#define FORESTVG_LAYOUT_HPP
+
+/**************************************************************************************************/
+
+// stdc++
+#include <cstddef>
+#include <vector>
+
+// application
+#include "state.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+constexpr auto node_size_k{50};
+constexpr auto node_radius_k{node_size_k / 2};
+constexpr auto node_spacing_k{25};
+constexpr auto tier_height_k{50};
+
+/**************************************************************************************************/
+// Node positions in struct-of-arrays form, indexed by the preorder position of the node.
+// (x, y) is the top-left corner of the node's `node_size_k` square.
+struct layout {
+    std::vector<double> _x;
+    std::vector<double> _y;
+    double _width{0};  // canvas, margins included
+    double _height{0}; // canvas, margins included
+};
+
+/**************************************************************************************************/
+// One fullorder sweep derives depths (so y) and the parent of each node, then x follows the
+// settings' `layout_style`:
+//
+// - widths: each parent is as wide as its children (plus spacing) and is centered over them. The
+//   widths come out of the same fullorder sweep, and one preorder sweep over them derives x.
+// - tidy: see `tidy_offsets`.
+//
+// Nothing recurses.
+layout derive_layout(const node_forest& f, const graph_settings& settings);
+
+/**************************************************************************************************/
+
+constexpr std::size_t top_level_k{static_cast<std::size_t>(-1)};
+
+// The tidy layout of Reingold and Tilford, as generalized to any number of children by Walker
+// and made linear time by Buchheim, Juenger and Leipert. Subtrees (and the top-level trees) are
+// pushed together until their contours are `node_size_k + node_spacing_k` apart at some depth,
+// smaller subtrees between two larger ones are spaced out evenly, and each parent is centered
+// over its first and last child. `parents` holds the parent of each node, in preorder, with
+// `top_level_k` for the top-level nodes. Returns the left side of each node's square, the
+// leftmost at 0. Linear time, without recursion.
+std::vector<double> tidy_offsets(const std::vector<std::size_t>& parents);
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
+
+#endif // FORESTVG_LAYOUT_HPP
+
+/**************************************************************************************************/
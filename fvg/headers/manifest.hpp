@@ -0,0 +1,64 @@
+/**************************************************************************************************/
+
+#ifndef FORESTVG_MANIFEST_HPP
+#define FORESTVG_MANIFEST_HPP
+
+/**************************************************************************************************/
+
+// stdc++
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+// A fast, non-cryptographic 64-bit hash (MurmurHash64A). Stable across platforms and builds, so
+// it can be stored.
+std::uint64_t content_hash(const char* first, const char* last, std::uint64_t seed = 0);
+
+inline std::uint64_t content_hash(std::string_view bytes, std::uint64_t seed = 0) {
+    return content_hash(bytes.data(), bytes.data() + bytes.size(), seed);
+}
+
+/**************************************************************************************************/
+/*
+    What an output directory was last rendered from: the content hash of each input, by file
+    name, and a hash of everything else the output depends on (the renderer version and the
+    options). A manifest that can't be read, or that was written for other settings, is empty.
+*/
+class render_manifest {
+public:
+    static constexpr std::string_view file_name_k{".fvg-manifest"};
+
+    explicit render_manifest(std::uint64_t settings) : _settings{settings} {}
+    render_manifest(const std::filesystem::path& path, std::uint64_t settings);
+
+    // Whether `name` was rendered from an input with this hash.
+    bool current(const std::string& name, std::uint64_t hash) const;
+
+    void set(std::string name, std::uint64_t hash);
+    void erase(const std::string& name) { _hashes.erase(name); }
+
+    // Replaces the file at `path` as a whole, so an interrupted save leaves the old one.
+    void save(const std::filesystem::path& path) const;
+
+private:
+    std::uint64_t _settings{0};
+    std::unordered_map<std::string, std::uint64_t> _hashes;
+};
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
+
+#endif // FORESTVG_MANIFEST_HPP
+
+/**************************************************************************************************/
@@ -0,0 +1,63 @@
+/**************************************************************************************************/
+
+#ifndef FORESTVG_MAPPED_FILE_HPP
+#define FORESTVG_MAPPED_FILE_HPP
+
+/**************************************************************************************************/
+
+// stdc++
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+// How `mapped_file` gets at the bytes.
+enum class file_access {
+    map,  // map regular files, read everything else
+    copy, // read everything
+};
+
+/**************************************************************************************************/
+/*
+    The contents of a file as a read-only byte range. Regular files are memory-mapped, so the
+    bytes are paged in as they are read instead of being copied to the heap up front. Anything
+    that can't be mapped (pipes, special files, platforms without mmap) is read into a buffer
+    instead. A file that cannot be opened yields an empty range, as `slurp_json` always has; one
+    that opens but then fails to read throws std::runtime_error.
+
+    A mapping of a file that is truncated while it is read faults (SIGBUS) on the pages that are
+    gone. Use `file_access::copy` for files that may be written to at the same time.
+*/
+class mapped_file {
+public:
+    explicit mapped_file(const std::filesystem::path& path,
+                         file_access access = file_access::map);
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    ~mapped_file();
+
+    const char* begin() const { return _first; }
+    const char* end() const { return _first + _size; }
+    std::size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+private:
+    const char* _first{nullptr};
+    std::size_t _size{0};
+    void* _mapping{nullptr}; // non-null iff the bytes are mapped
+    std::string _buffer;     // the bytes, when they are not
+};
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
+
+#endif // FORESTVG_MAPPED_FILE_HPP
+
+/**************************************************************************************************/
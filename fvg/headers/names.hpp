@@ -0,0 +1,124 @@
+/**************************************************************************************************/
+
+#ifndef FORESTVG_NAMES_HPP
+#define FORESTVG_NAMES_HPP
+
+/**************************************************************************************************/
+
+// stdc++
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+using name_id = std::uint32_t;
+
+/**************************************************************************************************/
+/*
+    Interns the node and edge names of a graph. Each distinct name is stored once and is known
+    everywhere else by its id, which is dense (0, 1, 2, ... in order of first appearance) so it
+    can index a vector directly. Id 0 is always the empty name.
+*/
+class name_table {
+public:
+    static constexpr name_id empty_k{0};
+
+    name_table() { intern(std::string()); }
+
+    // The index points into `_names`, whose elements never move (deque::push_back doesn't
+    // relocate, and moving a deque moves its blocks), but a copy needs an index of its own.
+    name_table(const name_table& x) : _names{x._names} { reindex(); }
+    name_table(name_table&&) noexcept = default;
+    name_table& operator=(const name_table& x) {
+        _names = x._names;
+        reindex();
+        return *this;
+    }
+    name_table& operator=(name_table&&) noexcept = default;
+
+    name_id intern(std::string&& name) {
+        const auto found{_ids.find(name)};
+        if (found != _ids.end()) return found->second;
+
+        const auto id{static_cast<name_id>(_names.size())};
+        _names.push_back(std::move(name));
+        _ids.emplace(_names.back(), id);
+        return id;
+    }
+
+    name_id intern(std::string_view name) {
+        const auto found{_ids.find(name)};
+        return found != _ids.end() ? found->second : intern(std::string(name));
+    }
+
+    name_id intern(const char* name) { return intern(std::string_view(name)); }
+
+    // Returns `empty_k` if the name was never interned.
+    name_id find(std::string_view name) const {
+        const auto found{_ids.find(name)};
+        return found != _ids.end() ? found->second : empty_k;
+    }
+
+    const std::string& operator[](name_id id) const {
+        assert(id < _names.size());
+        return _names[id];
+    }
+
+    std::size_t size() const { return _names.size(); }
+
+private:
+    void reindex() {
+        _ids.clear();
+        for (std::size_t i{0}; i < _names.size(); ++i) {
+            _ids.emplace(_names[i], static_cast<name_id>(i));
+        }
+    }
+
+    std::deque<std::string> _names;
+    std::unordered_map<std::string_view, name_id> _ids;
+};
+
+/**************************************************************************************************/
+// Per-name values, indexed by name id. A name without a value of its own reads as a
+// default-constructed T; writing to it makes room for it.
+template <typename T>
+class name_map {
+public:
+    const T& operator[](name_id id) const {
+        return id < _values.size() ? _values[id] : default_value();
+    }
+
+    T& operator[](name_id id) {
+        if (id >= _values.size()) _values.resize(id + 1);
+        return _values[id];
+    }
+
+    void clear() { _values.clear(); }
+
+private:
+    static const T& default_value() {
+        static const T value{};
+        return value;
+    }
+
+    std::vector<T> _values;
+};
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
+
+#endif // FORESTVG_NAMES_HPP
+
+/**************************************************************************************************/
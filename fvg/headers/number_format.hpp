@@ -0,0 +1,44 @@
+/**************************************************************************************************/
+
+#ifndef FORESTVG_NUMBER_FORMAT_HPP
+#define FORESTVG_NUMBER_FORMAT_HPP
+
+/**************************************************************************************************/
+
+// stdc++
+#include <string>
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+struct number_format {
+    static constexpr int shortest_k{-1};
+    static constexpr int max_precision_k{9};
+
+    // `shortest_k` writes the shortest decimal that reads back as the same double. Otherwise this
+    // is the number of decimals to round to, after which trailing zeros (and a dangling decimal
+    // point) are dropped: 125.0 is written as "125", 0.5 as "0.5" and -0.0001 at 3 as "0".
+    int _precision{3};
+
+    // Without it a magnitude below 1 starts at the decimal point: ".5", "-.25".
+    bool _leading_zero{true};
+};
+
+/**************************************************************************************************/
+// Appends `x` to `out` in the given format. Locale-independent; never uses exponent notation
+// for values an SVG coordinate could reasonably have. Throws std::runtime_error if `x` is not
+// finite.
+void append_number(std::string& out, double x, const number_format& format);
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
+
+#endif // FORESTVG_NUMBER_FORMAT_HPP
+
+/**************************************************************************************************/
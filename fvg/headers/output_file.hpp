@@ -0,0 +1,41 @@
+/**************************************************************************************************/
+
+#ifndef FORESTVG_OUTPUT_FILE_HPP
+#define FORESTVG_OUTPUT_FILE_HPP
+
+/**************************************************************************************************/
+
+// stdc++
+#include <filesystem>
+#include <string_view>
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+// Names standard output wherever an output path is expected, so fvg can sit in a pipeline.
+constexpr std::string_view stdout_path_k{"-"};
+
+inline bool is_stdout_path(const std::filesystem::path& path) { return path == stdout_path_k; }
+
+/**************************************************************************************************/
+// Replaces the contents of `path` (or writes to standard output; see `stdout_path_k`) with
+// `bytes`, handing them to the OS in as few calls as it will take them. Throws if the file can't
+// be created or written.
+void write_output(const std::filesystem::path& path, std::string_view bytes);
+
+// The same, gzip-compressed at zlib `level` (0-9) on the way out. `bytes` are whole already; it is
+// the compressed output that goes out one chunk at a time, and is never held whole.
+void write_gzip_output(const std::filesystem::path& path, std::string_view bytes, int level);
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
+
+#endif // FORESTVG_OUTPUT_FILE_HPP
+
+/**************************************************************************************************/
@@ -0,0 +1,205 @@
+/**************************************************************************************************/
+
+#ifndef FORESTVG_POOL_ALLOCATOR_HPP
+#define FORESTVG_POOL_ALLOCATOR_HPP
+
+/**************************************************************************************************/
+
+// stdc++
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// stlab
+#include <stlab/forest.hpp>
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+namespace detail {
+
+/**************************************************************************************************/
+// A slab of fixed-size slots. The slot size is set by the first single-object allocation; any
+// other request (arrays, or a rebound type that doesn't fit the slot) goes to the global heap.
+// Slots are carved out of geometrically growing chunks in address order, so nodes allocated
+// one after another (which is how forests are built) end up next to one another in memory.
+// Freed slots go on a free list; once the last live slot is freed the pool rewinds to the start
+// of its first chunk. Chunks are only returned to the system when the pool is destroyed.
+class node_pool {
+public:
+    node_pool() = default;
+    node_pool(const node_pool&) = delete;
+    node_pool& operator=(const node_pool&) = delete;
+
+    ~node_pool() {
+        for (auto& chunk : _chunks) {
+            ::operator delete(chunk._first, std::align_val_t{_align});
+        }
+    }
+
+    // `n` objects of `size` bytes each.
+    void* allocate(std::size_t size, std::size_t align, std::size_t n) {
+        if (!_size && n == 1) {
+            _size = std::max(round_up(size, align), sizeof(free_slot));
+            _align = std::max(align, alignof(free_slot));
+        }
+
+        if (!fits(size, align, n)) {
+            return ::operator new(size * n, std::align_val_t{align});
+        }
+
+        ++_live;
+
+        if (_free) {
+            void* result{_free};
+            _free = _free->_next;
+            return result;
+        }
+
+        if (_next == _last) {
+            next_chunk();
+        }
+
+        void* result{_next};
+        _next += _size;
+        return result;
+    }
+
+    void deallocate(void* p, std::size_t size, std::size_t align, std::size_t n) {
+        if (!fits(size, align, n)) {
+            ::operator delete(p, std::align_val_t{align});
+            return;
+        }
+
+        if (--_live == 0) {
+            rewind();
+            return;
+        }
+
+        _free = ::new (p) free_slot{_free};
+    }
+
+    std::size_t live() const { return _live; }
+
+private:
+    struct free_slot {
+        free_slot* _next;
+    };
+
+    struct chunk {
+        std::byte* _first;
+        std::byte* _last;
+    };
+
+    static constexpr std::size_t first_chunk_slots_k{64};
+    static constexpr std::size_t max_chunk_slots_k{64 * 1024};
+
+    static std::size_t round_up(std::size_t n, std::size_t align) {
+        return (n + align - 1) / align * align;
+    }
+
+    bool fits(std::size_t size, std::size_t align, std::size_t n) const {
+        return n == 1 && size <= _size && align <= _align;
+    }
+
+    void next_chunk() {
+        if (_current + 1 < _chunks.size()) {
+            ++_current;
+        } else {
+            const auto slots{_chunks.empty() ?
+                                 first_chunk_slots_k :
+                                 std::min(max_chunk_slots_k,
+                                          2 * chunk_slots(_chunks.back()))};
+            const auto bytes{slots * _size};
+            auto* first{static_cast<std::byte*>(::operator new(bytes, std::align_val_t{_align}))};
+            _chunks.push_back(chunk{first, first + bytes});
+            _current = _chunks.size() - 1;
+        }
+
+        _next = _chunks[_current]._first;
+        _last = _chunks[_current]._last;
+    }
+
+    std::size_t chunk_slots(const chunk& c) const { return (c._last - c._first) / _size; }
+
+    void rewind() {
+        _free = nullptr;
+        _current = 0;
+
+        if (!_chunks.empty()) {
+            _next = _chunks.front()._first;
+            _last = _chunks.front()._last;
+        }
+    }
+
+    std::size_t _size{0};
+    std::size_t _align{alignof(std::max_align_t)};
+    std::size_t _live{0};
+    std::vector<chunk> _chunks;
+    std::size_t _current{0};
+    std::byte* _next{nullptr};
+    std::byte* _last{nullptr};
+    free_slot* _free{nullptr};
+};
+
+/**************************************************************************************************/
+
+} // namespace detail
+
+/**************************************************************************************************/
+// A node allocator for stlab::forest. Copies (and rebound copies) share one pool, which lives
+// until the last of them goes away. Copy-constructing a container gets a fresh pool, so two
+// forests only share memory when one was moved or spliced out of the other. Not thread safe.
+template <typename T>
+class pool_allocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+
+    pool_allocator() : _pool{std::make_shared<detail::node_pool>()} {}
+
+    template <typename U>
+    pool_allocator(const pool_allocator<U>& x) noexcept : _pool{x._pool} {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(_pool->allocate(sizeof(T), alignof(T), n));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        _pool->deallocate(p, sizeof(T), alignof(T), n);
+    }
+
+    pool_allocator select_on_container_copy_construction() const { return pool_allocator(); }
+
+    friend bool operator==(const pool_allocator& a, const pool_allocator& b) {
+        return a._pool == b._pool;
+    }
+
+    friend bool operator!=(const pool_allocator& a, const pool_allocator& b) { return !(a == b); }
+
+private:
+    template <typename U>
+    friend class pool_allocator;
+
+    std::shared_ptr<detail::node_pool> _pool;
+};
+
+/**************************************************************************************************/
+
+template <typename T>
+using pooled_forest = stlab::forest<T, pool_allocator<T>>;
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
+
+#endif // FORESTVG_POOL_ALLOCATOR_HPP
+
+/**************************************************************************************************/
@@ -6,7 +6,7 @@
 /**************************************************************************************************/
 
 // stdc++
-#include <unordered_map>
+#include <string_view>
 
 // stlab
 #include <stlab/forest.hpp>
@@ -14,6 +14,9 @@
 // application
 #include "geometry.hpp"
 #include "json.hpp"
+#include "mapped_file.hpp"
+#include "names.hpp"
+#include "pool_allocator.hpp"
 
 /**************************************************************************************************/
 
@@ -37,20 +40,31 @@ struct edge_properties {
     std::string _text_anchor{"middle"};
 };
 
+enum class layout_style {
+    widths, // each parent exactly as wide as its children, plus spacing between them
+    tidy,   // subtrees packed together by their contours (Reingold-Tilford, after Walker)
+};
+
+// "widths" (or empty, as for a null value) or "tidy"; throws on anything else.
+layout_style to_layout_style(std::string_view name);
+
 struct graph_settings {
+    layout_style _layout{layout_style::widths};
     bool _with_root{false};
     bool _with_leaf_edges{true};
     bool _with_root_top{false};
     extents _margin{25, 10, 25, 10};
 };
 
-using node_forest = stlab::forest<std::string>;
+// Everything below refers to names by their id in the state's `name_table`.
+using node_forest = pooled_forest<name_id>;
 using node_iterator = node_forest::iterator;
-using node_map = std::unordered_map<std::string, node_properties>;
-using edge_map = std::unordered_map<std::string, edge_properties>;
-using edge_labels = std::vector<std::string>;
+using node_map = name_map<node_properties>;
+using edge_map = name_map<edge_properties>;
+using edge_labels = std::vector<name_id>;
 
 struct state {
+    name_table _names;
     node_forest _f;
     node_map _n;
     edge_map _e;
@@ -60,8 +74,16 @@ struct state {
 
 /**************************************************************************************************/
 
+// None of the loaders (nor the layout and writer passes downstream of them) recurse on the
+// structure of the forest, so its maximum nesting depth is bounded only by available memory, and
+// a chain of any depth loads in time linear in its length.
 state make_state(const fvg::json_t& j);
 
+// Parse JSON text straight into a state; no json_t is built. Equivalent to
+// `make_state(parse_json(...))` and `make_state(slurp_json(path))`, respectively.
+state parse_state(const char* first, const char* last);
+state slurp_state(const std::filesystem::path& path, file_access access = file_access::map);
+
 /**************************************************************************************************/
 
 } // namespace fvg
@@ -7,11 +7,14 @@
 
 // stdc++
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 // application
 #include "geometry.hpp"
+#include "names.hpp"
+#include "number_format.hpp"
 
 /**************************************************************************************************/
 
@@ -37,7 +40,9 @@ struct cubic_path {
 
     // These details aren't related to the SVG node directly, but are used by fvg
     bool _leading;
-    std::string _id;
+    name_id _id;
+    double _label_t; // where on _b the edge label goes
+
 };
 
 /**************************************************************************************************/
@@ -83,6 +88,102 @@ struct arrowhead {
 using node = std::variant<line, cubic_path, text, circle, square, arrowhead>;
 using nodes = std::vector<node>;
 
+// Moves the element by `d`.
+void translate(node& n, const point& d);
+
+/**************************************************************************************************/
+
+struct writer_options {
+    number_format _numbers; // applied to every coordinate and length
+
+    // Leaves out the XML declaration, indentation and line breaks, attributes that only restate
+    // the SVG initial value, and any separator or leading zero a number can do without. Renders
+    // the same as the regular output.
+    bool _minify{false};
+
+    // Node shapes and arrowheads are defined once per distinct look in <defs> and drawn with
+    // <use>, which only carries the position (and, for arrowheads, the angle).
+    bool _shared_shapes{false};
+
+    // Every distinct set of presentation attributes (stroke, fill, font-size, ...) becomes one
+    // rule in a <style> block, and the elements carry the class of their set instead.
+    bool _style_classes{false};
+
+    // Edges of one look (color, width and dasharray) are drawn as the subpaths of one <path>, and
+    // the arrowheads of one color as one filled <path>. An edge with a label keeps an element of
+    // its own. The edges written in a row are grouped, so they may come out in another order.
+    bool _coalesce_edges{false};
+};
+
+/**************************************************************************************************/
+// Serializes SVG elements straight into a string, one after another, as they are handed over.
+// Nothing is kept per element besides the text it appends.
+class writer {
+public:
+    explicit writer(std::string& out, const writer_options& options = writer_options());
+
+    // Writes the XML declaration and opens the <svg> element. Pair with `end()`.
+    void begin(double width, double height);
+    void end();
+
+    void write(const node& n);
+    void write(const line& l);
+    void write(const cubic_path& p);
+    void write(const text& t);
+    void write(const circle& c);
+    void write(const square& s);
+    void write(const arrowhead& a);
+
+private:
+    void indent();
+    void newline();
+    // Cuts the attributes written since `at` out of the output and returns the id of the shared
+    // definition of a `tag` element with them, adding one if there is none yet.
+    name_id define(const char* tag, std::size_t at);
+    void use(name_id def);
+    // With `_style_classes`, replaces the presentation attributes written since `at` with the
+    // class of that set of them.
+    void classify(std::size_t at);
+    // With `_coalesce_edges`, moves the path data written since `data_at` to the group of the
+    // presentation attributes written between `at` and it.
+    void coalesce(std::size_t at, std::size_t data_at);
+    void flush_edges();
+    void write_head();
+    void write_style();
+    void write_defs();
+    void open_tag(const char* tag);
+    void close_empty_tag();
+    void attribute(const char* name, std::string_view value);
+    void attribute(const char* name, double value);
+    // Left out when minifying and `value` is the SVG initial value of the attribute.
+    void attribute(const char* name, std::string_view value, std::string_view initial);
+    void number(double x) { append_number(_out, x, _format); }
+    void separated_number(double x); // " x", or "-x" in place of " -x" when minifying
+    void coordinates(const point& p); // "x y"
+    void path_data(const cubic_bezier& b); // "M x y C x y x y x y"
+    void arrowhead_data(const arrowhead& a); // "M x y L x y x y Z"
+
+    std::string& _out;
+    number_format _format;
+    bool _minify{false};
+    bool _shared_shapes{false};
+    bool _style_classes{false};
+    bool _coalesce_edges{false};
+    std::size_t _depth{0};
+
+    // The attributes of each class, and "tag attributes" of each definition, by id. Where the
+    // <style> and <defs> go, once they are all known.
+    name_table _classes;
+    name_table _defs;
+    std::string _def_key;
+    std::size_t _head_at{0};
+
+    // The path data of the edges not yet written out, by the id of their attributes.
+    name_table _edge_styles;
+    std::vector<std::string> _edge_groups;
+    bool _pending_edges{false};
+};
+
 /**************************************************************************************************/
 
 } // namespace svg
@@ -0,0 +1,44 @@
+/**************************************************************************************************/
+
+#ifndef FORESTVG_WATCH_HPP
+#define FORESTVG_WATCH_HPP
+
+/**************************************************************************************************/
+
+// stdc++
+#include <filesystem>
+#include <functional>
+
+// application
+#include "batch.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+/*
+    Renders `srcdir` into `dstdir` like `render_directory`, then keeps watching `srcdir` and
+    renders each file again once it has been written to (or moved in) and then left alone for a
+    moment, so the writes of one save come out as one render. The output of a file that is
+    deleted (or moved out) is deleted with it. The renders run on stlab::default_executor, and
+    the `render_manifest` in `dstdir` is kept up to date after each one. Hidden files and editor
+    backups ("name~") are not watched.
+
+    Only returns by throwing, if `srcdir` can't be watched or goes away. `report` gets every file
+    that fails, one call at a time, from whichever thread rendered it. Needs inotify (Linux).
+*/
+[[noreturn]] void watch_directory(const std::filesystem::path& srcdir,
+                                  const std::filesystem::path& dstdir,
+                                  const batch_options& options,
+                                  const std::function<void(const batch_error&)>& report);
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
+
+#endif // FORESTVG_WATCH_HPP
+
+/**************************************************************************************************/
@@ -6,10 +6,16 @@
 /**************************************************************************************************/
 
 // stdc++
+#include <cstddef>
 #include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
 
 // application
+#include "output_file.hpp"
 #include "state.hpp"
+#include "svg.hpp"
 
 /**************************************************************************************************/
 
@@ -17,7 +23,139 @@ namespace fvg {
 
 /**************************************************************************************************/
 
-void write_svg(state state, const std::filesystem::path& path);
+constexpr std::string_view svgz_extension_k{".svgz"};
+
+// Changes whenever the same state and options would be drawn differently than before, so that
+// incremental batches (see `batch_options::_incremental`) render everything again.
+constexpr std::string_view render_version_k{"1"};
+
+struct write_options {
+    svg::writer_options _svg; // how the document is serialized
+
+    // The output is gzip-compressed at `_gzip_level` (0-9) when `_gzip` is set or the path ends
+    // in `svgz_extension_k`. Only the compressed side streams: the document is deflated once it
+    // is complete, since `_shared_shapes` and `_style_classes` put its head together last.
+    bool _gzip{false};
+    int _gzip_level{6};
+
+    // How far (in output units) edge trimming and label placement may be off. 0 uses a fixed
+    // amount of work per edge instead; see `alp`.
+    double _arc_tolerance{0};
+};
+
+/**************************************************************************************************/
+// The SVG document of `state`, assembled in memory.
+std::string render_svg(state state, const write_options& options = write_options());
+
+// Writes a document out whole, compressed if `options` say so; `path` may be `stdout_path_k`.
+void write_document(const std::filesystem::path& path,
+                    std::string_view document,
+                    const write_options& options = write_options());
+
+// `write_document(path, render_svg(state, options), options)`.
+void write_svg(state state,
+               const std::filesystem::path& path,
+               const write_options& options = write_options());
+
+/**************************************************************************************************/
+/*
+    Keeps everything `write_svg` derives from a state (positions, node shapes and labels, edges
+    and edge labels) next to the forest, so an edit only redoes what it touches:
+
+    - the widths of the ancestors of the edit, for as long as they keep changing;
+    - the x offsets of the nodes after the edit in fullorder, the ancestors included (their
+      trailing edges come after it). A tidy layout isn't local like that, so with
+      `layout_style::tidy` every node is placed again;
+    - the edges with an end that changed, or moved relative to the other end, or that now carry a
+      different edge label. Edges whose ends moved together are translated instead.
+
+    The drawing is the one `write_svg` makes of the edited state, save for the last bit of the
+    coordinates of translated edges. Change the forest only through the members below.
+*/
+class live_layout {
+public:
+    // What was derived for the edge that arrives at one edge of a node in the fullorder walk.
+    struct edge_slot {
+        std::size_t _index{0}; // fullorder position of the edge it arrives at
+        name_id _label{name_table::empty_k};
+        bool _dirty{true};     // an end of it was inserted, erased or renamed
+        double _from_x{0};     // x of the nodes at either end, as of the last update
+        double _to_x{0};
+        svg::nodes _edge;      // the path and its arrowhead; empty if the edge isn't drawn
+        svg::nodes _edge_label;
+    };
+
+    struct node {
+        name_id _name{name_table::empty_k};
+        std::size_t _depth{0};
+        std::size_t _width{0};          // as in `derive_layout`
+        std::size_t _children_width{0}; // the children's widths, plus spacing after each
+        std::size_t _left{0};           // where the node's width (and its first child) starts
+        point _p;                       // top-left of the node's square
+        svg::node _shape;
+        svg::text _label;
+        edge_slot _in[2]; // arriving at the leading, then the trailing, edge of the node
+    };
+
+    using forest_type = pooled_forest<node>;
+    using iterator = forest_type::iterator;
+    using const_iterator = forest_type::const_iterator;
+
+    explicit live_layout(state state, const write_options& options = write_options());
+    live_layout(const live_layout&) = delete; // the index points into the forest
+    live_layout& operator=(const live_layout&) = delete;
+
+    const forest_type& forest() const { return _f; }
+    const name_table& names() const { return _state._names; }
+    const write_options& options() const { return _options; }
+    iterator root() { return _f.root(); }
+    iterator begin() { return _f.begin(); }
+    iterator end() { return _f.end(); }
+
+    // Inserts a leaf before `position`, as `forest::insert` does. Returns its leading edge.
+    iterator insert(const iterator& position, std::string_view name);
+
+    // Erases the node at `position` and all of its descendants. Returns the edge after them.
+    iterator erase(const iterator& position);
+
+    void rename(const iterator& position, std::string_view name);
+
+    // Node properties go by name, so this restyles every node named as the one at `position`.
+    void restyle(const iterator& position, node_properties properties);
+
+    double width() const;
+    double height() const;
+
+    // Appends the SVG document, as `write_svg` would write it.
+    void write(std::string& out) const;
+
+private:
+    template <typename I>
+    static auto& slot(const I& i) { return i->_in[stlab::is_leading(i) ? 0 : 1]; }
+
+    node make_node(name_id name, std::size_t depth);
+    void index(const iterator& leading);
+    void unindex(const iterator& leading);
+    void reshape(node& n);
+    iterator parent_of(const iterator& position);
+    void resize(iterator parent, std::ptrdiff_t delta, std::vector<iterator>& moved);
+    void refresh(iterator first, const std::vector<iterator>& also);
+    void place_tidy();
+    name_id label_at(std::size_t index) const;
+
+    state _state; // all but the forest, which moves into `_f`
+    write_options _options;
+    name_id _root_name;
+    forest_type _f;
+    std::size_t _top_width{0};       // as `_children_width`, for the top-level nodes
+    double _tidy_width{0};           // of everything drawn, for `layout_style::tidy`
+    std::vector<std::size_t> _tiers; // nodes at each depth
+    name_map<std::vector<iterator>> _named; // the leading edge of each node, by name
+    svg::nodes _top_loop;            // the root's top loop, when drawn
+    svg::nodes _top_loop_label;
+};
+
+void write_svg(const live_layout& layout, const std::filesystem::path& path);
 
 /**************************************************************************************************/
 
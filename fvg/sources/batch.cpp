@@ -0,0 +1,340 @@
+/**************************************************************************************************/
+
+// stdc++
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// stlab
+#include <stlab/concurrency/channel.hpp>
+#include <stlab/concurrency/default_executor.hpp>
+#include <stlab/concurrency/future.hpp>
+#include <stlab/concurrency/immediate_executor.hpp>
+#include <stlab/concurrency/utility.hpp>
+
+// identity
+#include "batch.hpp"
+
+// application
+#include "manifest.hpp"
+#include "mapped_file.hpp"
+#include "number_format.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+std::filesystem::path output_path(const std::filesystem::path& dstdir,
+                                  const std::filesystem::path& src,
+                                  const write_options& options) {
+    return (dstdir / src.stem()).replace_extension(options._gzip ? svgz_extension_k : ".svg");
+}
+
+/**************************************************************************************************/
+
+std::string render_file(const std::filesystem::path& src,
+                        const std::filesystem::path& dst,
+                        const write_options& options,
+                        file_access access,
+                        std::uint64_t* hash) try {
+    const mapped_file input{src, access};
+    if (hash) *hash = content_hash(input.begin(), input.end());
+    write_svg(parse_state(input.begin(), input.end()), dst, options);
+    return std::string();
+} catch (const std::exception& error) {
+    return *error.what() ? error.what() : "unknown exception";
+} catch (...) {
+    return "unknown exception";
+}
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// One file on its way through the pipeline. Move-only, so the channels hand it from stage to
+// stage instead of copying it. Once a stage fails, the rest pass the error along untouched.
+struct batch_item {
+    batch_item() = default;
+    batch_item(const batch_item&) = delete;
+    batch_item(batch_item&&) noexcept = default;
+    batch_item& operator=(const batch_item&) = delete;
+    batch_item& operator=(batch_item&&) noexcept = default;
+
+    std::size_t _index{0};
+    std::unique_ptr<const mapped_file> _input;
+    state _state;
+    std::uint64_t _hash{0}; // of the input
+    std::string _document;
+    std::string _error;
+};
+
+template <typename F> // F models UnaryFunction of batch_item&
+batch_item run_stage(batch_item item, F&& stage) {
+    if (!item._error.empty()) return item;
+
+    try {
+        stage(item);
+    } catch (const std::exception& error) {
+        item._error = *error.what() ? error.what() : "unknown exception";
+    } catch (...) {
+        item._error = "unknown exception";
+    }
+
+    return item;
+}
+
+/**************************************************************************************************/
+// A process that lets at most `depth` files queue up ahead of it.
+template <typename F>
+auto buffered(std::size_t depth, F process) {
+    return stlab::buffer_size{depth} & std::move(process);
+}
+
+/**************************************************************************************************/
+// Reading in the first stage means faulting the mapped pages in there, so the parse stage finds
+// them in memory instead of waiting on the disk itself.
+void prefault(const mapped_file& input) {
+    constexpr std::size_t page_size_k{4096};
+    volatile char sink{0};
+
+    for (std::size_t i{0}, n{input.size()}; i < n; i += page_size_k) {
+        sink = input.begin()[i];
+    }
+
+    static_cast<void>(sink);
+}
+
+/**************************************************************************************************/
+/*
+    Each lane is a channel of four processes: read, parse, render and write. A process handles
+    one file at a time, so the four overlap on four different files, and a process that is
+    `depth` files ahead of the next one waits for it. That keeps at most a few files per lane in
+    memory, whatever the size of the directory. Files are dealt to the lanes in turn.
+*/
+void render_pipelined(const std::vector<std::filesystem::path>& inputs,
+                      const std::filesystem::path& dstdir,
+                      const write_options& options,
+                      file_access access,
+                      std::size_t lanes,
+                      std::size_t depth,
+                      std::vector<std::string>& errors,
+                      std::vector<std::uint64_t>& hashes) {
+    const auto n{inputs.size()};
+    std::atomic<std::size_t> finished{0};
+    auto [done, all_done]{stlab::package<void()>(stlab::immediate_executor, [] {})};
+
+    const auto read{[&](batch_item item) {
+        return run_stage(std::move(item), [&](batch_item& x) {
+            x._input = std::make_unique<const mapped_file>(inputs[x._index], access);
+            x._hash = content_hash(x._input->begin(), x._input->end());
+            prefault(*x._input);
+        });
+    }};
+    const auto parse{[](batch_item item) {
+        return run_stage(std::move(item), [](batch_item& x) {
+            x._state = parse_state(x._input->begin(), x._input->end());
+            x._input.reset();
+        });
+    }};
+    const auto render{[&](batch_item item) {
+        return run_stage(std::move(item), [&](batch_item& x) {
+            x._document = render_svg(std::move(x._state), options);
+        });
+    }};
+    const auto write{[&](batch_item item) {
+        item = run_stage(std::move(item), [&](batch_item& x) {
+            write_document(output_path(dstdir, inputs[x._index], options), x._document, options);
+        });
+
+        errors[item._index] = std::move(item._error);
+        hashes[item._index] = item._hash;
+
+        if (++finished == n) done();
+    }};
+
+    std::vector<stlab::sender<std::size_t>> senders;
+    std::vector<stlab::receiver<void>> pipelines;
+
+    for (std::size_t lane{0}; lane < lanes; ++lane) {
+        auto [send, receive]{stlab::channel<std::size_t>(stlab::default_executor)};
+
+        pipelines.push_back(receive
+            | [](std::size_t index) {
+                  batch_item result;
+                  result._index = index;
+                  return result;
+              }
+            | buffered(depth, read)
+            | buffered(depth, parse)
+            | buffered(depth, render)
+            | buffered(depth, write));
+
+        receive.set_ready();
+        senders.push_back(std::move(send));
+    }
+
+    for (std::size_t i{0}; i < n; ++i) {
+        senders[i % lanes](i);
+    }
+
+    for (auto& send : senders) {
+        send.close();
+    }
+
+    stlab::blocking_get(std::move(all_done));
+}
+
+/**************************************************************************************************/
+// The manifest, or one halfway through being saved; only an input if the outputs go elsewhere.
+bool is_manifest(const std::filesystem::path& path) {
+    const auto name{path.filename().string()};
+    return name == render_manifest::file_name_k ||
+           name == std::string(render_manifest::file_name_k) + ".tmp";
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+// Any new write option goes here, too.
+std::uint64_t settings_hash(const write_options& options) {
+    const auto& svg{options._svg};
+    std::string settings{render_version_k};
+
+    for (const auto x : {static_cast<double>(svg._numbers._precision),
+                         static_cast<double>(svg._numbers._leading_zero),
+                         static_cast<double>(svg._minify),
+                         static_cast<double>(svg._shared_shapes),
+                         static_cast<double>(svg._style_classes),
+                         static_cast<double>(svg._coalesce_edges),
+                         options._arc_tolerance,
+                         static_cast<double>(options._gzip),
+                         static_cast<double>(options._gzip_level)}) {
+        settings += ' ';
+        append_number(settings, x, number_format{number_format::shortest_k});
+    }
+
+    return content_hash(settings);
+}
+
+/**************************************************************************************************/
+
+std::vector<batch_error> render_directory(const std::filesystem::path& srcdir,
+                                          const std::filesystem::path& dstdir,
+                                          const batch_options& options) {
+    std::error_code error;
+    const auto same_directory{std::filesystem::equivalent(srcdir, dstdir, error)};
+    std::vector<std::filesystem::path> inputs;
+
+    for (const auto& entry : std::filesystem::directory_iterator{srcdir}) {
+        if (!is_regular_file(entry) || (same_directory && is_manifest(entry.path()))) continue;
+        inputs.push_back(entry.path());
+    }
+
+    std::sort(inputs.begin(), inputs.end());
+
+    // An incremental batch hashes every input but only goes on with the ones that changed (or
+    // whose output went missing) since the last time. Any batch records the hash of each input
+    // it renders, as read for the render, so that the manifest never vouches for an output that
+    // was written with other settings.
+
+    const auto settings{settings_hash(options._write)};
+    const auto manifest_path{dstdir / render_manifest::file_name_k};
+    render_manifest updated{settings};
+
+    if (options._incremental) {
+        const render_manifest previous{manifest_path, settings};
+        std::vector<std::filesystem::path> changed;
+
+        for (auto& input : inputs) {
+            const mapped_file bytes{input, options._access};
+            const auto hash{content_hash(bytes.begin(), bytes.end())};
+            auto name{input.filename().string()};
+
+            if (previous.current(name, hash) &&
+                exists(output_path(dstdir, input, options._write))) {
+                updated.set(std::move(name), hash);
+            } else {
+                changed.push_back(std::move(input));
+            }
+        }
+
+        inputs = std::move(changed);
+    }
+
+    const auto n{inputs.size()};
+    std::vector<std::string> errors(n); // one slot per input, so the jobs never share one
+    std::vector<std::uint64_t> hashes(n);
+
+    auto jobs{options._jobs ? options._jobs : std::thread::hardware_concurrency()};
+    jobs = std::clamp<std::size_t>(jobs, 1, std::max<std::size_t>(n, 1));
+
+    const auto render_next{[&](std::size_t i) {
+        const auto dst{output_path(dstdir, inputs[i], options._write)};
+        errors[i] = render_file(inputs[i], dst, options._write, options._access, &hashes[i]);
+    }};
+
+    if (options._pipeline_depth && n) {
+        render_pipelined(inputs,
+                         dstdir,
+                         options._write,
+                         options._access,
+                         jobs,
+                         options._pipeline_depth,
+                         errors,
+                         hashes);
+    } else if (jobs == 1) {
+        for (std::size_t i{0}; i < n; ++i) {
+            render_next(i);
+        }
+    } else {
+        // Each job pulls the next unclaimed file until there are none left, which keeps every
+        // job busy regardless of how uneven the files are.
+        std::atomic<std::size_t> next{0};
+
+        const auto job{[&] {
+            for (auto i{next++}; i < n; i = next++) {
+                render_next(i);
+            }
+        }};
+
+        std::vector<stlab::future<void>> running;
+        running.reserve(jobs);
+
+        for (std::size_t i{0}; i < jobs; ++i) {
+            running.push_back(stlab::async(stlab::default_executor, job));
+        }
+
+        for (auto& f : running) {
+            stlab::blocking_get(std::move(f));
+        }
+    }
+
+    // A file that failed is left out, so the next batch tries it again.
+    for (std::size_t i{0}; i < n; ++i) {
+        if (errors[i].empty()) updated.set(inputs[i].filename().string(), hashes[i]);
+    }
+
+    updated.save(manifest_path);
+
+    std::vector<batch_error> result;
+
+    for (std::size_t i{0}; i < n; ++i) {
+        if (!errors[i].empty()) {
+            result.push_back(batch_error{std::move(inputs[i]), std::move(errors[i])});
+        }
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
@@ -0,0 +1,275 @@
+/**************************************************************************************************/
+
+// stdc++
+#include <cmath>
+
+#if !defined(FORESTVG_NO_SIMD) && defined(__AVX2__)
+    #define FORESTVG_BATCH_AVX2() 1
+    #define FORESTVG_BATCH_SSE2() 0
+    #include <immintrin.h>
+#elif !defined(FORESTVG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+    #define FORESTVG_BATCH_AVX2() 0
+    #define FORESTVG_BATCH_SSE2() 1
+    #include <emmintrin.h>
+#else
+    #define FORESTVG_BATCH_AVX2() 0
+    #define FORESTVG_BATCH_SSE2() 0
+#endif
+
+// identity
+#include "bezier_batch.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+void cubic_bezier_soa::reserve(std::size_t n) {
+    for (auto* v : {&_sx, &_sy, &_c1x, &_c1y, &_c2x, &_c2y, &_ex, &_ey}) {
+        v->reserve(n);
+    }
+}
+
+void cubic_bezier_soa::push_back(const cubic_bezier& b) {
+    _sx.push_back(b._s.x);
+    _sy.push_back(b._s.y);
+    _c1x.push_back(b._c1.x);
+    _c1y.push_back(b._c1.y);
+    _c2x.push_back(b._c2.x);
+    _c2y.push_back(b._c2.y);
+    _ex.push_back(b._e.x);
+    _ey.push_back(b._e.y);
+}
+
+cubic_bezier cubic_bezier_soa::operator[](std::size_t i) const {
+    return cubic_bezier{{_sx[i], _sy[i]}, {_c1x[i], _c1y[i]}, {_c2x[i], _c2y[i]}, {_ex[i], _ey[i]}};
+}
+
+/**************************************************************************************************/
+
+namespace batch {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// One lane; also finishes off whatever the wider types leave over.
+struct scalar_v {
+    static constexpr std::size_t width_k{1};
+
+    double _v;
+
+    static scalar_v load(const double* p) { return {*p}; }
+    static scalar_v broadcast(double x) { return {x}; }
+    void store(double* p) const { *p = _v; }
+
+    friend scalar_v operator+(scalar_v a, scalar_v b) { return {a._v + b._v}; }
+    friend scalar_v operator*(scalar_v a, scalar_v b) { return {a._v * b._v}; }
+    friend scalar_v sqrt(scalar_v a) { return {std::sqrt(a._v)}; }
+};
+
+#if FORESTVG_BATCH_AVX2()
+
+struct wide_v {
+    static constexpr std::size_t width_k{4};
+
+    __m256d _v;
+
+    static wide_v load(const double* p) { return {_mm256_loadu_pd(p)}; }
+    static wide_v broadcast(double x) { return {_mm256_set1_pd(x)}; }
+    void store(double* p) const { _mm256_storeu_pd(p, _v); }
+
+    friend wide_v operator+(wide_v a, wide_v b) { return {_mm256_add_pd(a._v, b._v)}; }
+    friend wide_v operator*(wide_v a, wide_v b) { return {_mm256_mul_pd(a._v, b._v)}; }
+    friend wide_v sqrt(wide_v a) { return {_mm256_sqrt_pd(a._v)}; }
+};
+
+#elif FORESTVG_BATCH_SSE2()
+
+struct wide_v {
+    static constexpr std::size_t width_k{2};
+
+    __m128d _v;
+
+    static wide_v load(const double* p) { return {_mm_loadu_pd(p)}; }
+    static wide_v broadcast(double x) { return {_mm_set1_pd(x)}; }
+    void store(double* p) const { _mm_storeu_pd(p, _v); }
+
+    friend wide_v operator+(wide_v a, wide_v b) { return {_mm_add_pd(a._v, b._v)}; }
+    friend wide_v operator*(wide_v a, wide_v b) { return {_mm_mul_pd(a._v, b._v)}; }
+    friend wide_v sqrt(wide_v a) { return {_mm_sqrt_pd(a._v)}; }
+};
+
+#else
+
+using wide_v = scalar_v;
+
+#endif
+
+/**************************************************************************************************/
+// Calls `f(V(), i)` for i in [0, n) in steps of V::width_k: V is wide_v while a full vector fits,
+// then scalar_v for the rest.
+template <typename F>
+void for_each_lane(std::size_t n, F&& f) {
+    std::size_t i{0};
+
+    if constexpr (wide_v::width_k > 1) {
+        for (; i + wide_v::width_k <= n; i += wide_v::width_k) {
+            f(wide_v(), i);
+        }
+    }
+
+    for (; i < n; ++i) {
+        f(scalar_v(), i);
+    }
+}
+
+/**************************************************************************************************/
+// A cubic (or, with _a3 = 0, a quadratic) in power form per axis; evaluated by Horner's rule.
+struct polynomial {
+    double _a0, _a1, _a2, _a3;
+
+    template <typename V>
+    V operator()(V t) const {
+        const auto a0{V::broadcast(_a0)};
+        const auto a1{V::broadcast(_a1)};
+        const auto a2{V::broadcast(_a2)};
+        const auto a3{V::broadcast(_a3)};
+
+        return ((a3 * t + a2) * t + a1) * t + a0;
+    }
+};
+
+polynomial position(double s, double c1, double c2, double e) {
+    return {s, 3 * (c1 - s), 3 * (s - 2 * c1 + c2), e - s + 3 * (c1 - c2)};
+}
+
+polynomial velocity(double s, double c1, double c2, double e) {
+    return {3 * (c1 - s), 6 * (s - 2 * c1 + c2), 3 * (e - s + 3 * (c1 - c2)), 0};
+}
+
+/**************************************************************************************************/
+// The four Bernstein weights at t (or, for the derivative, the three weights of the hodograph
+// applied to successive control point differences).
+struct bernstein {
+    double _w0, _w1, _w2, _w3;
+};
+
+bernstein position_weights(double t) {
+    const auto u{1 - t};
+    return {u * u * u, 3 * u * u * t, 3 * u * t * t, t * t * t};
+}
+
+// B'(t) = 3u^2 (c1 - s) + 6ut (c2 - c1) + 3t^2 (e - c2), regrouped onto the control points.
+bernstein velocity_weights(double t) {
+    const auto u{1 - t};
+    const auto a{3 * u * u};
+    const auto b{6 * u * t};
+    const auto c{3 * t * t};
+    return {-a, a - b, b - c, c};
+}
+
+void weigh(const std::vector<double>& p0,
+           const std::vector<double>& p1,
+           const std::vector<double>& p2,
+           const std::vector<double>& p3,
+           const bernstein& w,
+           double* out) {
+    for_each_lane(p0.size(), [&](auto v, std::size_t i) {
+        using V = decltype(v);
+        const auto r{V::load(&p0[i]) * V::broadcast(w._w0) +
+                     V::load(&p1[i]) * V::broadcast(w._w1) +
+                     V::load(&p2[i]) * V::broadcast(w._w2) +
+                     V::load(&p3[i]) * V::broadcast(w._w3)};
+        r.store(&out[i]);
+    });
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+void evaluate(const cubic_bezier& b, const double* t, std::size_t n, double* x, double* y) {
+    const auto px{position(b._s.x, b._c1.x, b._c2.x, b._e.x)};
+    const auto py{position(b._s.y, b._c1.y, b._c2.y, b._e.y)};
+
+    for_each_lane(n, [&](auto v, std::size_t i) {
+        using V = decltype(v);
+        const auto ti{V::load(&t[i])};
+        px(ti).store(&x[i]);
+        py(ti).store(&y[i]);
+    });
+}
+
+/**************************************************************************************************/
+
+void derivative(const cubic_bezier& b, const double* t, std::size_t n, double* x, double* y) {
+    const auto dx{velocity(b._s.x, b._c1.x, b._c2.x, b._e.x)};
+    const auto dy{velocity(b._s.y, b._c1.y, b._c2.y, b._e.y)};
+
+    for_each_lane(n, [&](auto v, std::size_t i) {
+        using V = decltype(v);
+        const auto ti{V::load(&t[i])};
+        dx(ti).store(&x[i]);
+        dy(ti).store(&y[i]);
+    });
+}
+
+/**************************************************************************************************/
+
+void speed(const cubic_bezier& b, const double* t, std::size_t n, double* s) {
+    const auto dx{velocity(b._s.x, b._c1.x, b._c2.x, b._e.x)};
+    const auto dy{velocity(b._s.y, b._c1.y, b._c2.y, b._e.y)};
+
+    for_each_lane(n, [&](auto v, std::size_t i) {
+        using V = decltype(v);
+        const auto ti{V::load(&t[i])};
+        const auto x{dx(ti)};
+        const auto y{dy(ti)};
+        sqrt(x * x + y * y).store(&s[i]);
+    });
+}
+
+/**************************************************************************************************/
+
+void evaluate(const cubic_bezier_soa& c, double t, double* x, double* y) {
+    const auto w{position_weights(t)};
+
+    weigh(c._sx, c._c1x, c._c2x, c._ex, w, x);
+    weigh(c._sy, c._c1y, c._c2y, c._ey, w, y);
+}
+
+/**************************************************************************************************/
+
+void derivative(const cubic_bezier_soa& c, double t, double* x, double* y) {
+    const auto w{velocity_weights(t)};
+
+    weigh(c._sx, c._c1x, c._c2x, c._ex, w, x);
+    weigh(c._sy, c._c1y, c._c2y, c._ey, w, y);
+}
+
+/**************************************************************************************************/
+
+const char* instruction_set() {
+#if FORESTVG_BATCH_AVX2()
+    return "avx2";
+#elif FORESTVG_BATCH_SSE2()
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+/**************************************************************************************************/
+
+} // namespace batch
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
@@ -3,8 +3,13 @@
 // identity
 #include "geometry.hpp"
 
+// application
+#include "bezier_batch.hpp"
+
 // stdc++
 #include <cassert>
+#include <iterator>
+#include <tuple>
 
 /**************************************************************************************************/
 
@@ -17,12 +22,10 @@ point cubic_bezier::operator()(double t) const {
     assert(t <= 1);
 
     const auto u{1 - t};
-    auto p0_term{1 * std::pow(u, 3) * 1             };
-    auto p1_term{3 * std::pow(u, 2) * t             };
-    auto p2_term{3 * u              * std::pow(t, 2)};
-    auto p3_term{1 * 1              * std::pow(t, 3)};
+    const auto uu{u * u};
+    const auto tt{t * t};
 
-    return _s * p0_term + _c1 * p1_term + _c2 * p2_term + _e * p3_term;
+    return _s * (uu * u) + _c1 * (3 * uu * t) + _c2 * (3 * u * tt) + _e * (tt * t);
 }
 
 /**************************************************************************************************/
@@ -32,11 +35,8 @@ point cubic_bezier::derivative(double t) const {
     assert(t <= 1);
 
     const auto u{1 - t};
-    auto p0_term{3 * std::pow(u, 2)};
-    auto p1_term{6 * u * t};
-    auto p2_term{3 * std::pow(t, 2)};
 
-    return (_c1 - _s) * p0_term + (_c2 - _c1) * p1_term + (_e - _c2) * p2_term;
+    return (_c1 - _s) * (3 * u * u) + (_c2 - _c1) * (6 * u * t) + (_e - _c2) * (3 * t * t);
 }
 
 /**************************************************************************************************/
@@ -54,39 +54,216 @@ std::pair<cubic_bezier, cubic_bezier> cubic_bezier::subdivide(double t) const {
 
 /**************************************************************************************************/
 
-void alp::compute_arc_table() {
-    for (std::size_t i(0); i < sz_k; ++i) {
-        auto t{i / static_cast<double>(sz_k)};
-        _a[i] = _b(t);
+namespace {
+
+// 5-point Gauss-Legendre nodes and weights on [-1, 1]. The speed of a cubic isn't a polynomial,
+// but it is smooth away from cusps, so 16 spans of this are plenty for the gentle curves fvg
+// draws. (A curve with a near-cusp can be off by a few hundredths of a unit.)
+constexpr std::size_t gauss_n_k{5};
+constexpr double gauss_x_k[gauss_n_k]{
+    -0.9061798459386640, -0.5384693101056831, 0, 0.5384693101056831, 0.9061798459386640,
+};
+constexpr double gauss_w_k[gauss_n_k]{
+    0.2369268850561891, 0.4786286704993665, 0.5688888888888889, 0.4786286704993665,
+    0.2369268850561891,
+};
+
+// How close (in output units) the fixed-mode `find` gets before it stops refining.
+constexpr double find_tolerance_k{1e-6};
+constexpr int find_iterations_k{16};
+
+// Adaptive mode never splits a piece more than this many times, so that a degenerate curve (or
+// an absurdly small tolerance) can't run away.
+constexpr int max_depth_k{30};
+
+// A curve's length lies between its chord and its control polygon; the gap closes quickly as
+// the curve is subdivided.
+std::pair<double, double> length_bounds(const cubic_bezier& b) {
+    return {(b._e - b._s).magnitude(),
+            (b._c1 - b._s).magnitude() + (b._c2 - b._c1).magnitude() +
+                (b._e - b._c2).magnitude()};
+}
+
+// The quadrature nodes of [t0, t1].
+void gauss_nodes(double t0, double t1, double* out) {
+    const auto half{(t1 - t0) / 2};
+    const auto mid{t0 + half};
+
+    for (std::size_t j{0}; j < gauss_n_k; ++j) {
+        out[j] = mid + half * gauss_x_k[j];
+    }
+}
+
+double gauss_sum(const double* speeds, double t0, double t1) {
+    double sum{0};
+
+    for (std::size_t j{0}; j < gauss_n_k; ++j) {
+        sum += gauss_w_k[j] * speeds[j];
     }
 
+    return sum * (t1 - t0) / 2;
+}
+
+} // namespace
+
+/**************************************************************************************************/
+
+alp::alp(const cubic_bezier& b, double tolerance) : _b{b}, _tolerance{tolerance} {
+    if (_tolerance > 0) {
+        build_adaptive();
+    } else {
+        build_fixed();
+    }
+}
+
+/**************************************************************************************************/
+
+void alp::build_fixed() {
+    // Every curve is sampled at the same parameters, so work those out once.
+    static const auto nodes_k{[] {
+        std::array<double, spans_k * gauss_n_k> result;
+        for (std::size_t i{0}; i < spans_k; ++i) {
+            gauss_nodes(static_cast<double>(i) / spans_k,
+                        static_cast<double>(i + 1) / spans_k,
+                        &result[i * gauss_n_k]);
+        }
+        return result;
+    }()};
+
+    std::array<double, spans_k * gauss_n_k> speeds;
+
+    batch::speed(_b, nodes_k.data(), nodes_k.size(), speeds.data());
+
     _l[0] = 0;
 
-    for (std::size_t i(0); i < (sz_k - 1); ++i) {
-        const auto& a{_a[i]};
-        const auto& b{_a[i + 1]};
-        const auto l{(b - a).magnitude()};
-        _l[i + 1] = _l[i] + l;
+    for (std::size_t i{0}; i < spans_k; ++i) {
+        _l[i + 1] = _l[i] + gauss_sum(&speeds[i * gauss_n_k],
+                                      static_cast<double>(i) / spans_k,
+                                      static_cast<double>(i + 1) / spans_k);
+    }
+
+    _length = _l.back();
+}
+
+/**************************************************************************************************/
+
+void alp::build_adaptive() {
+    struct pending {
+        cubic_bezier _b;
+        double _t0;
+        double _t1;
+        double _tolerance; // what this piece may contribute to the error in the total length
+        int _depth;
+    };
+
+    std::vector<pending> stack{{_b, 0, 1, _tolerance, 0}};
+
+    while (!stack.empty()) {
+        const auto p{stack.back()};
+        stack.pop_back();
+
+        const auto [chord, polygon]{length_bounds(p._b)};
+
+        if (polygon - chord <= p._tolerance || p._depth == max_depth_k) {
+            _pieces.push_back(piece{p._b, p._t0, p._t1, _length});
+            _length += (chord + polygon) / 2;
+            continue;
+        }
+
+        const auto halves{p._b.subdivide(0.5)};
+        const auto mid{(p._t0 + p._t1) / 2};
+
+        // The right half goes on first so that pieces come off the stack in curve order.
+        stack.push_back({halves.second, mid, p._t1, p._tolerance / 2, p._depth + 1});
+        stack.push_back({halves.first, p._t0, mid, p._tolerance / 2, p._depth + 1});
     }
 }
 
 /**************************************************************************************************/
 
+double alp::length(double t0, double t1) const {
+    double nodes[gauss_n_k];
+    double speeds[gauss_n_k];
+
+    gauss_nodes(t0, t1, nodes);
+    batch::speed(_b, nodes, gauss_n_k, speeds);
+
+    return gauss_sum(speeds, t0, t1);
+}
+
+/**************************************************************************************************/
+
 double alp::find(double u) const {
-    auto upper(std::upper_bound(_l.begin(), _l.end(), u));
-    auto lower(upper == _l.begin() ? _l.begin() : std::prev(upper));
+    if (!(u > 0)) return 0;
+    if (u >= length()) return 1;
+
+    return _tolerance > 0 ? find_adaptive(u) : find_fixed(u);
+}
+
+/**************************************************************************************************/
 
-    assert(upper != _l.end());
-    assert(lower != _l.end());
+double alp::find_fixed(double u) const {
+    // _l[i] <= u < _l[i + 1]
+    const auto i{static_cast<std::size_t>(std::upper_bound(_l.begin(), _l.end(), u) -
+                                          _l.begin() - 1)};
+    const auto knot{static_cast<double>(i) / spans_k};
+    double lo{knot};
+    double hi{static_cast<double>(i + 1) / spans_k};
+    double t{lerp(lo, hi, delerp(u, _l[i], _l[i + 1]))};
+
+    for (int n{0}; n < find_iterations_k; ++n) {
+        const auto error{_l[i] + length(knot, t) - u};
+
+        if (std::abs(error) <= find_tolerance_k) break;
+
+        (error > 0 ? hi : lo) = t;
+
+        const auto s{_b.derivative(t).magnitude()};
+        const auto next{s > 0 ? t - error / s : lo};
+
+        // Newton can overshoot where the speed is changing quickly; keep to the bracket.
+        t = next > lo && next < hi ? next : (lo + hi) / 2;
+    }
+
+    return t;
+}
+
+/**************************************************************************************************/
+
+double alp::find_adaptive(double u) const {
+    // the last piece starting at or before u
+    const auto found{std::prev(std::upper_bound(
+        _pieces.begin(), _pieces.end(), u, [](double u, const piece& p) { return u < p._l0; }))};
+
+    auto b{found->_b};
+    auto t0{found->_t0};
+    auto t1{found->_t1};
+    auto before{found->_l0};
+    auto [chord, polygon]{length_bounds(b)};
+
+    // Halve toward u until the piece is too short for the choice of t within it to matter.
+    for (int depth{0}; polygon > _tolerance && depth < max_depth_k; ++depth) {
+        const auto halves{b.subdivide(0.5)};
+        const auto mid{(t0 + t1) / 2};
+        const auto [left_chord, left_polygon]{length_bounds(halves.first)};
+        const auto left{(left_chord + left_polygon) / 2};
+
+        if (u - before <= left) {
+            b = halves.first;
+            t1 = mid;
+            chord = left_chord;
+            polygon = left_polygon;
+        } else {
+            before += left;
+            b = halves.second;
+            t0 = mid;
+            std::tie(chord, polygon) = length_bounds(b);
+        }
+    }
 
-    double t_unit{1.0 / sz_k};
-    auto t_first_index{std::distance(_l.begin(), lower)};
-    auto t_second_index{std::distance(_l.begin(), upper)};
-    double t_first{t_first_index * t_unit};
-    double t_second{t_second_index * t_unit};
-    double sub_t(delerp(u, *lower, *upper));
+    const auto length{(chord + polygon) / 2};
 
-    return lerp(t_first, t_second, sub_t);
+    return lerp(t0, t1, length > 0 ? std::clamp((u - before) / length, 0., 1.) : 0.);
 }
 
 /**************************************************************************************************/
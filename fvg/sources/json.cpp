@@ -1,8 +1,7 @@
 /**************************************************************************************************/
 
-#include <fstream>
-
 #include "json.hpp"
+#include "mapped_file.hpp"
 
 /**************************************************************************************************/
 
@@ -21,22 +20,9 @@ json_t parse_json(const std::string& json_raw) {
 /**************************************************************************************************/
 
 json_t slurp_json(const std::filesystem::path& path) {
-    std::ifstream input{path, std::ios::in | std::ios::binary};
-
-    if (!input)
-        return json_t();
-
-    std::string json_raw;
-
-    input.seekg(0, std::ios::end);
-
-    json_raw.resize(input.tellg());
-
-    input.seekg(0, std::ios::beg);
-
-    input.read(&json_raw[0], json_raw.size());
+    const mapped_file input{path};
 
-    return json_raw.empty() ? json_t() : parse_json(json_raw);
+    return input.empty() ? json_t() : json_t::parse(input.begin(), input.end());
 }
 
 /**************************************************************************************************/
@@ -0,0 +1,330 @@
+/**************************************************************************************************/
+
+// identity
+#include "layout.hpp"
+
+// stdc++
+#include <algorithm>
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+// The working state of `tidy_offsets`, named after the paper ("Improving Walker's Algorithm to
+// Run in Linear Time", Buchheim, Juenger and Leipert, 2002). Nodes are indexed in preorder, with
+// one more node at the end standing in for the root of the forest.
+class tidy_tree {
+public:
+    explicit tidy_tree(const std::vector<std::size_t>& parents);
+
+    std::vector<double> offsets();
+
+private:
+    static constexpr std::size_t none_k{static_cast<std::size_t>(-1)};
+    static constexpr double distance_k{node_size_k + node_spacing_k};
+
+    std::size_t next_left(std::size_t v) const {
+        return _first_child[v] != none_k ? _first_child[v] : _thread[v];
+    }
+    std::size_t next_right(std::size_t v) const {
+        return _last_child[v] != none_k ? _last_child[v] : _thread[v];
+    }
+
+    void first_walk(std::size_t v);
+    std::size_t apportion(std::size_t v, std::size_t default_ancestor);
+    void move_subtree(std::size_t wl, std::size_t wr, double shift);
+    void execute_shifts(std::size_t v);
+
+    std::size_t _root;
+    std::vector<std::size_t> _parent;
+    std::vector<std::size_t> _first_child;
+    std::vector<std::size_t> _last_child;
+    std::vector<std::size_t> _left_sibling;
+    std::vector<std::size_t> _right_sibling;
+    std::vector<std::size_t> _number; // position among its siblings
+    std::vector<std::size_t> _thread;
+    std::vector<std::size_t> _ancestor;
+    std::vector<std::size_t> _default_ancestor; // of the children apportioned so far
+    std::vector<double> _prelim;
+    std::vector<double> _mod;
+    std::vector<double> _shift;
+    std::vector<double> _change;
+};
+
+/**************************************************************************************************/
+
+tidy_tree::tidy_tree(const std::vector<std::size_t>& parents) :
+    _root{parents.size()}, _parent(_root + 1, none_k), _first_child(_root + 1, none_k),
+    _last_child(_root + 1, none_k), _left_sibling(_root + 1, none_k),
+    _right_sibling(_root + 1, none_k), _number(_root + 1, 0), _thread(_root + 1, none_k),
+    _ancestor(_root + 1), _default_ancestor(_root + 1, none_k), _prelim(_root + 1, 0),
+    _mod(_root + 1, 0), _shift(_root + 1, 0), _change(_root + 1, 0) {
+    // Children are met in order in preorder.
+    for (std::size_t v{0}; v < _root; ++v) {
+        const auto p{parents[v] == top_level_k ? _root : parents[v]};
+        auto& last{_last_child[p]};
+
+        if (last == none_k) {
+            _first_child[p] = v;
+            _default_ancestor[p] = v;
+        } else {
+            _left_sibling[v] = last;
+            _right_sibling[last] = v;
+            _number[v] = _number[last] + 1;
+        }
+
+        _parent[v] = p;
+        last = v;
+    }
+
+    for (std::size_t v{0}; v <= _root; ++v) {
+        _ancestor[v] = v;
+    }
+}
+
+/**************************************************************************************************/
+
+std::vector<double> tidy_tree::offsets() {
+    // First walk, in postorder: a node is placed once all of its children are, and then
+    // apportioned against its left siblings before the next one is started.
+
+    std::vector<std::size_t> stack{_root};
+    std::vector<std::size_t> next_child{_first_child};
+
+    while (!stack.empty()) {
+        const auto v{stack.back()};
+
+        if (const auto w{next_child[v]}; w != none_k) {
+            next_child[v] = _right_sibling[w];
+            stack.push_back(w);
+            continue;
+        }
+
+        stack.pop_back();
+        first_walk(v);
+
+        if (v != _root) {
+            auto& default_ancestor{_default_ancestor[_parent[v]]};
+            default_ancestor = apportion(v, default_ancestor);
+        }
+    }
+
+    // Second walk, in preorder: sum the modifiers of the ancestors.
+
+    std::vector<double> result(_root);
+    std::vector<double> mods(_root + 1, 0);
+    double min_x{0};
+
+    for (std::size_t v{0}; v < _root; ++v) {
+        result[v] = _prelim[v] + mods[_parent[v]];
+        mods[v] = mods[_parent[v]] + _mod[v];
+        min_x = v ? std::min(min_x, result[v]) : result[v];
+    }
+
+    for (auto& x : result) {
+        x -= min_x;
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+void tidy_tree::first_walk(std::size_t v) {
+    const auto w{_left_sibling[v]};
+
+    if (_first_child[v] == none_k) {
+        _prelim[v] = w != none_k ? _prelim[w] + distance_k : 0;
+        return;
+    }
+
+    execute_shifts(v);
+
+    const auto midpoint{(_prelim[_first_child[v]] + _prelim[_last_child[v]]) / 2};
+
+    if (w != none_k) {
+        _prelim[v] = _prelim[w] + distance_k;
+        _mod[v] = _prelim[v] - midpoint;
+    } else {
+        _prelim[v] = midpoint;
+    }
+}
+
+/**************************************************************************************************/
+// Walks down the right contour of the subtrees to the left of `v` and the left contour of the
+// subtree of `v` together, moving the latter right wherever the two come closer than the
+// distance. i and o are the inside and outside contours; p and m are right (plus) and left.
+std::size_t tidy_tree::apportion(std::size_t v, std::size_t default_ancestor) {
+    const auto w{_left_sibling[v]};
+
+    if (w == none_k) return default_ancestor;
+
+    auto vip{v};
+    auto vop{v};
+    auto vim{w};
+    auto vom{_first_child[_parent[v]]};
+    auto sip{_mod[vip]};
+    auto sop{_mod[vop]};
+    auto sim{_mod[vim]};
+    auto som{_mod[vom]};
+
+    while (next_right(vim) != none_k && next_left(vip) != none_k) {
+        vim = next_right(vim);
+        vip = next_left(vip);
+        vom = next_left(vom);
+        vop = next_right(vop);
+        _ancestor[vop] = v;
+
+        const auto shift{(_prelim[vim] + sim) - (_prelim[vip] + sip) + distance_k};
+
+        if (shift > 0) {
+            const auto a{_ancestor[vim]};
+            move_subtree(_parent[a] == _parent[v] ? a : default_ancestor, v, shift);
+            sip += shift;
+            sop += shift;
+        }
+
+        sim += _mod[vim];
+        sip += _mod[vip];
+        som += _mod[vom];
+        sop += _mod[vop];
+    }
+
+    if (next_right(vim) != none_k && next_right(vop) == none_k) {
+        _thread[vop] = next_right(vim);
+        _mod[vop] += sim - sop;
+    }
+
+    if (next_left(vip) != none_k && next_left(vom) == none_k) {
+        _thread[vom] = next_left(vip);
+        _mod[vom] += sip - som;
+        default_ancestor = v;
+    }
+
+    return default_ancestor;
+}
+
+/**************************************************************************************************/
+// Moves the subtree at `wr` right by `shift`, and records that the subtrees between `wl` and
+// `wr` get their share of it when `execute_shifts` runs on the parent.
+void tidy_tree::move_subtree(std::size_t wl, std::size_t wr, double shift) {
+    const auto share{shift / static_cast<double>(_number[wr] - _number[wl])};
+
+    _change[wr] -= share;
+    _shift[wr] += shift;
+    _change[wl] += share;
+    _prelim[wr] += shift;
+    _mod[wr] += shift;
+}
+
+/**************************************************************************************************/
+
+void tidy_tree::execute_shifts(std::size_t v) {
+    double shift{0};
+    double change{0};
+
+    for (auto w{_last_child[v]}; w != none_k; w = _left_sibling[w]) {
+        _prelim[w] += shift;
+        _mod[w] += shift;
+        change += _change[w];
+        shift += _shift[w] + change;
+    }
+}
+
+/**************************************************************************************************/
+
+std::vector<double> tidy_offsets(const std::vector<std::size_t>& parents) {
+    return tidy_tree(parents).offsets();
+}
+
+/**************************************************************************************************/
+
+layout derive_layout(const node_forest& f, const graph_settings& settings) {
+    struct open_node {
+        std::size_t _index;
+        std::size_t _width; // running sum of child widths (plus spacing)
+    };
+
+    std::vector<std::size_t> widths;
+    std::vector<std::size_t> parents;
+    std::vector<open_node> open{{top_level_k, 0}};
+    std::size_t max_depth{0};
+    layout result;
+
+    // Fullorder: depths (and so y) on the way down, widths on the way back up, and the parent of
+    // each node for the x sweep below.
+
+    for (auto first{f.begin()}, last{f.end()}; first != last; ++first) {
+        if (stlab::is_leading(first)) {
+            const auto depth{open.size() - 1};
+            const std::size_t y(settings._margin.t + (tier_height_k + node_spacing_k) * depth);
+
+            max_depth = std::max(max_depth, depth);
+            parents.push_back(open.back()._index);
+            result._y.push_back(y);
+            widths.push_back(0);
+            open.push_back({widths.size() - 1, 0});
+        } else {
+            const auto node{open.back()};
+            open.pop_back();
+
+            // pull out one spacing amount (it's between nodes, not one for each.)
+            const auto width{node._width ? node._width - node_spacing_k : node_size_k};
+            widths[node._index] = width;
+            open.back()._width += width + node_spacing_k;
+        }
+    }
+
+    if (settings._layout == layout_style::tidy) {
+        result._x = tidy_offsets(parents);
+
+        double content_width{0};
+
+        for (auto& x : result._x) {
+            content_width = std::max(content_width, x + node_size_k);
+            x += settings._margin.l;
+        }
+
+        result._width = content_width + settings._margin.width();
+    } else {
+        // Preorder: each node's box starts where its parent's cursor is, then moves the cursor
+        // along.
+
+        const auto n{widths.size()};
+        std::vector<std::size_t> cursors(n);
+        std::size_t root_cursor(settings._margin.l);
+
+        result._x.resize(n);
+
+        for (std::size_t i{0}; i < n; ++i) {
+            auto& cursor{parents[i] == top_level_k ? root_cursor : cursors[parents[i]]};
+            result._x[i] = cursor + (widths[i] - node_size_k) / 2;
+            cursors[i] = cursor;
+            cursor += widths[i] + node_spacing_k;
+        }
+
+        const auto top_width{open.back()._width};
+        result._width = (top_width ? top_width - node_spacing_k : 0) + settings._margin.width();
+    }
+
+    // Canvas height.
+
+    // Keep the extra node spacing for the leaf node edges on the bottom of the graph.
+    auto height{(tier_height_k + node_spacing_k) * (max_depth + 1)};
+
+    // Unless, of course, there are no leaf edges.
+    if (!settings._with_leaf_edges) {
+        height -= node_spacing_k;
+    }
+
+    result._height = height + settings._margin.height();
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
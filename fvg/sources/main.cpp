@@ -1,51 +1,176 @@
 /**************************************************************************************************/
 
 // stdc++
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <string_view>
+#include <vector>
 
 // application
-#include "write.hpp"
+#include "batch.hpp"
+#include "watch.hpp"
 
 /**************************************************************************************************/
 
-int main(int argc, const char * argv[]) try {
-    if (argc != 3) {
-        throw std::runtime_error(std::string("Usage: ") + argv[0] + " input output");
+namespace {
+
+/**************************************************************************************************/
+
+struct arguments {
+    fvg::batch_options _batch; // _batch._write applies in single-file mode, too
+    bool _watch{false};
+    std::vector<std::string> _paths;
+};
+
+/**************************************************************************************************/
+
+auto usage(const char* name) {
+    return std::string("Usage: ") + name +
+           " [-j N] [--pipeline DEPTH] [--incremental] [--watch] [--precision N|shortest]"
+           " [--arc-tolerance X] [--minify] [--shared-shapes] [--style-classes] [--coalesce-edges]"
+           " [--gzip LEVEL] input output\n"
+           "An output of - writes a single input's SVG to standard output. An output ending in\n"
+           ".svgz is gzip-compressed, at level 6 unless --gzip says otherwise. --watch keeps\n"
+           "rendering the files of an input directory as they change.";
+}
+
+/**************************************************************************************************/
+
+int parse_int(std::string_view value, const char* flag, int min, int max) {
+    int result{0};
+    const auto last{value.data() + value.size()};
+    const auto [p, error]{std::from_chars(value.data(), last, result)};
+
+    if (error != std::errc() || p != last || result < min || result > max) {
+        throw std::runtime_error(std::string(flag) + " expects a number from " +
+                                 std::to_string(min) + " to " + std::to_string(max));
     }
 
-    std::filesystem::path srcpath{argv[1]};
-    std::filesystem::path dstpath{argv[2]};
+    return result;
+}
+
+/**************************************************************************************************/
+
+double parse_tolerance(const char* value) {
+    char* last{nullptr};
+    const auto result{std::strtod(value, &last)};
+
+    if (last == value || *last || !(result >= 0) || !std::isfinite(result)) {
+        throw std::runtime_error("--arc-tolerance expects a distance of 0 or more");
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+arguments parse_arguments(int argc, const char* argv[]) {
+    arguments result;
+
+    for (int i{1}; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+
+        if (arg == "-j") {
+            if (++i == argc) throw std::runtime_error(usage(argv[0]));
+            result._batch._jobs = parse_int(argv[i], "-j", 0, 1024);
+        } else if (arg == "--pipeline") {
+            if (++i == argc) throw std::runtime_error(usage(argv[0]));
+            result._batch._pipeline_depth = parse_int(argv[i], "--pipeline", 1, 64);
+        } else if (arg == "--watch") {
+            result._watch = true;
+        } else if (arg == "--incremental") {
+            result._batch._incremental = true;
+        } else if (arg == "--arc-tolerance") {
+            if (++i == argc) throw std::runtime_error(usage(argv[0]));
+            result._batch._write._arc_tolerance = parse_tolerance(argv[i]);
+        } else if (arg == "--minify") {
+            result._batch._write._svg._minify = true;
+        } else if (arg == "--shared-shapes") {
+            result._batch._write._svg._shared_shapes = true;
+        } else if (arg == "--style-classes") {
+            result._batch._write._svg._style_classes = true;
+        } else if (arg == "--coalesce-edges") {
+            result._batch._write._svg._coalesce_edges = true;
+        } else if (arg == "--gzip") {
+            if (++i == argc) throw std::runtime_error(usage(argv[0]));
+            result._batch._write._gzip = true;
+            result._batch._write._gzip_level = parse_int(argv[i], "--gzip", 0, 9);
+        } else if (arg == "--precision") {
+            if (++i == argc) throw std::runtime_error(usage(argv[0]));
+            const std::string_view value{argv[i]};
+            result._batch._write._svg._numbers._precision =
+                value == "shortest" ?
+                    fvg::number_format::shortest_k :
+                    parse_int(value, "--precision", 0, fvg::number_format::max_precision_k);
+        } else {
+            result._paths.emplace_back(arg);
+        }
+    }
+
+    if (result._paths.size() != 2) {
+        throw std::runtime_error(usage(argv[0]));
+    }
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+int main(int argc, const char * argv[]) try {
+    const auto args{parse_arguments(argc, argv)};
+
+    std::filesystem::path srcpath{args._paths[0]};
+    std::filesystem::path dstpath{args._paths[1]};
 
     if (!exists(srcpath)) {
         throw std::runtime_error(srcpath.string() + " does not exist");
     }
 
     bool src_dir{is_directory(srcpath)};
-    bool dst_dir{is_directory(dstpath)};
+    bool dst_dir{!fvg::is_stdout_path(dstpath) && is_directory(dstpath)};
+
+    if (args._watch && !src_dir) {
+        throw std::runtime_error("--watch needs an input directory");
+    }
 
     if (!src_dir) {
         if (dst_dir) {
             throw std::runtime_error("output type (file/directory) mismatch");
         }
 
-        fvg::write_svg(fvg::make_state(fvg::slurp_json(srcpath)), std::move(dstpath));
+        fvg::write_svg(fvg::slurp_state(srcpath), std::move(dstpath), args._batch._write);
     } else {
-        if (!exists(dstpath)) {
+        if (fvg::is_stdout_path(dstpath)) {
+            throw std::runtime_error("a directory of inputs needs an output directory, not -");
+        } else if (!exists(dstpath)) {
             create_directory(dstpath);
         } else if (!is_directory(dstpath)) {
             throw std::runtime_error("output type (file/directory) mismatch");
         }
 
-        for (const auto& src : std::filesystem::directory_iterator{srcpath}) {
-            if (!is_regular_file(src)) continue;
-            const auto& srcpath{src.path()};
-            auto dst{(dstpath / srcpath.stem()).replace_extension("svg")};
-            try {
-                fvg::write_svg(fvg::make_state(fvg::slurp_json(srcpath)), std::move(dst));
-            } catch (...) {
-                std::cerr << "Exception while processing file " << srcpath.string() << '\n';
-                throw;
-            }
+        const auto report{[](const fvg::batch_error& error) {
+            std::cerr << "Exception while processing file " << error._path.string() << ": "
+                      << error._what << '\n';
+        }};
+
+        if (args._watch) {
+            fvg::watch_directory(srcpath, dstpath, args._batch, report);
+        }
+
+        const auto errors{fvg::render_directory(srcpath, dstpath, args._batch)};
+
+        for (const auto& error : errors) {
+            report(error);
+        }
+
+        if (!errors.empty()) {
+            return EXIT_FAILURE;
         }
     }
 
@@ -0,0 +1,164 @@
+/**************************************************************************************************/
+
+// stdc++
+#include <charconv>
+#include <cstring>
+
+// identity
+#include "manifest.hpp"
+
+// application
+#include "mapped_file.hpp"
+#include "output_file.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// The first line; the number changes with the format.
+constexpr std::string_view header_k{"fvg-manifest 1"};
+
+/**************************************************************************************************/
+
+void append_hex(std::string& out, std::uint64_t x) {
+    char buffer[16];
+    const auto [p, error]{std::to_chars(std::begin(buffer), std::end(buffer), x, 16)};
+    out.append(16 - (p - buffer), '0');
+    out.append(buffer, p);
+}
+
+bool parse_hex(std::string_view s, std::uint64_t& x) {
+    const auto last{s.data() + s.size()};
+    const auto [p, error]{std::from_chars(s.data(), last, x, 16)};
+    return s.size() == 16 && error == std::errc() && p == last;
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+std::uint64_t content_hash(const char* first, const char* last, std::uint64_t seed) {
+    constexpr std::uint64_t m{0xc6a4a7935bd1e995};
+    constexpr int r{47};
+
+    const auto n{static_cast<std::uint64_t>(last - first)};
+    std::uint64_t h{seed ^ (n * m)};
+
+    for (; last - first >= 8; first += 8) {
+        std::uint64_t k;
+        std::memcpy(&k, first, 8);
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+    }
+
+    if (first != last) {
+        for (auto i{last - first}; i--;) {
+            h ^= static_cast<std::uint64_t>(static_cast<unsigned char>(first[i])) << (8 * i);
+        }
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+
+/**************************************************************************************************/
+/*
+    The format is line-based:
+
+        fvg-manifest 1
+        <settings hash>
+        <content hash> <file name>
+        ...
+
+    with hashes as 16 hex digits. The file name runs to the end of the line.
+*/
+render_manifest::render_manifest(const std::filesystem::path& path, std::uint64_t settings) :
+    render_manifest{settings} {
+    std::error_code error;
+    if (!is_regular_file(path, error)) return;
+
+    const mapped_file input{path};
+    std::string_view rest{input.begin(), input.size()};
+
+    const auto next_line{[&rest] {
+        const auto end{rest.find('\n')};
+        const auto line{rest.substr(0, end)};
+        rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+        return line;
+    }};
+
+    std::uint64_t recorded{0};
+
+    if (next_line() != header_k || !parse_hex(next_line(), recorded) || recorded != settings) {
+        return;
+    }
+
+    while (!rest.empty()) {
+        const auto line{next_line()};
+        std::uint64_t hash{0};
+
+        if (line.size() > 17 && line[16] == ' ' && parse_hex(line.substr(0, 16), hash)) {
+            _hashes.insert_or_assign(std::string(line.substr(17)), hash);
+        }
+    }
+}
+
+/**************************************************************************************************/
+
+bool render_manifest::current(const std::string& name, std::uint64_t hash) const {
+    const auto found{_hashes.find(name)};
+    return found != _hashes.end() && found->second == hash;
+}
+
+/**************************************************************************************************/
+
+void render_manifest::set(std::string name, std::uint64_t hash) {
+    // A name the format can't hold is simply never recorded, and so always rendered.
+    if (name.find('\n') != std::string::npos) return;
+
+    _hashes.insert_or_assign(std::move(name), hash);
+}
+
+/**************************************************************************************************/
+
+void render_manifest::save(const std::filesystem::path& path) const {
+    std::string out{header_k};
+    out += '\n';
+    append_hex(out, _settings);
+    out += '\n';
+
+    for (const auto& [name, hash] : _hashes) {
+        append_hex(out, hash);
+        out += ' ';
+        out += name;
+        out += '\n';
+    }
+
+    auto temporary{path};
+    temporary += ".tmp";
+
+    write_output(temporary, out);
+    std::filesystem::rename(temporary, path);
+}
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
@@ -0,0 +1,97 @@
+/**************************************************************************************************/
+
+// stdc++
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if __has_include(<sys/mman.h>)
+    #define FORESTVG_MMAP() 1
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#else
+    #define FORESTVG_MMAP() 0
+#endif
+
+// identity
+#include "mapped_file.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+#if FORESTVG_MMAP()
+
+mapped_file::mapped_file(const std::filesystem::path& path, file_access access) {
+    const int fd{::open(path.c_str(), O_RDONLY)};
+
+    if (fd == -1) return;
+
+    struct stat info;
+
+    if (access == file_access::map && ::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) &&
+        info.st_size > 0) {
+        void* p{::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)};
+
+        if (p != MAP_FAILED) {
+            ::madvise(p, info.st_size, MADV_SEQUENTIAL);
+            _mapping = p;
+            _first = static_cast<const char*>(p);
+            _size = info.st_size;
+        }
+    }
+
+    if (!_mapping) {
+        // Read until EOF rather than trusting st_size; it is meaningless for pipes.
+        char chunk[64 * 1024];
+
+        while (true) {
+            const auto n{::read(fd, chunk, sizeof(chunk))};
+            if (n > 0) {
+                _buffer.append(chunk, n);
+            } else if (n == 0) {
+                break;
+            } else if (errno != EINTR) {
+                ::close(fd);
+                throw std::runtime_error("error reading input file");
+            }
+        }
+
+        _first = _buffer.data();
+        _size = _buffer.size();
+    }
+
+    ::close(fd);
+}
+
+mapped_file::~mapped_file() {
+    if (_mapping) ::munmap(_mapping, _size);
+}
+
+#else
+
+mapped_file::mapped_file(const std::filesystem::path& path, file_access) {
+    std::ifstream input{path, std::ios::in | std::ios::binary};
+
+    if (input) {
+        _buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+
+    _first = _buffer.data();
+    _size = _buffer.size();
+}
+
+mapped_file::~mapped_file() = default;
+
+#endif
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
@@ -0,0 +1,166 @@
+/**************************************************************************************************/
+
+// stdc++
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+// nlohmann
+#include <nlohmann/json.hpp>
+
+// identity
+#include "number_format.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+
+constexpr std::uint64_t powers_of_ten_k[]{
+    1, 10, 100, 1'000, 10'000, 100'000, 1'000'000, 10'000'000, 100'000'000, 1'000'000'000,
+};
+
+static_assert(std::size(powers_of_ten_k) == number_format::max_precision_k + 1);
+
+/**************************************************************************************************/
+
+void append_unsigned(std::string& out, std::uint64_t x) {
+    char buffer[20];
+    char* p{std::end(buffer)};
+
+    do {
+        *--p = static_cast<char>('0' + x % 10);
+        x /= 10;
+    } while (x);
+
+    out.append(p, std::end(buffer));
+}
+
+/**************************************************************************************************/
+// Grisu2 gives the shortest digit string `digits` and exponent `e` such that digits * 10^e reads
+// back as `x`; all that's left is placing the decimal point.
+void append_shortest(std::string& out, double x, bool leading_zero) {
+    if (x == 0) {
+        out += '0';
+        return;
+    }
+
+    if (x < 0) {
+        out += '-';
+        x = -x;
+    }
+
+    char digits[std::numeric_limits<double>::max_digits10 + 1];
+    int len{0};
+    int e{0};
+
+    nlohmann::detail::dtoa_impl::grisu2(digits, len, e, x);
+
+    const int point{len + e}; // position of the decimal point relative to the first digit
+
+    if (point < -5 || point > 21) {
+        // Far outside anything a drawing needs; fall back to d.ddde[+-]n, which SVG accepts.
+        out += digits[0];
+        if (len > 1) {
+            out += '.';
+            out.append(digits + 1, len - 1);
+        }
+        out += 'e';
+        const int exponent{point - 1};
+        if (exponent < 0) out += '-';
+        append_unsigned(out, static_cast<std::uint64_t>(std::abs(exponent)));
+    } else if (point <= 0) {
+        if (leading_zero) out += '0';
+        out += '.';
+        out.append(-point, '0');
+        out.append(digits, len);
+    } else if (point >= len) {
+        out.append(digits, len);
+        out.append(point - len, '0');
+    } else {
+        out.append(digits, point);
+        out += '.';
+        out.append(digits + point, len - point);
+    }
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+void append_number(std::string& out, double x, const number_format& format) {
+    // An infinity or NaN here means the layout overflowed (a margin near DBL_MAX, say); there is
+    // no SVG number for it, so the document is rejected rather than written with garbage.
+    if (!std::isfinite(x)) {
+        throw std::runtime_error("number out of range; the layout is too large to write");
+    }
+
+    const auto precision{format._precision};
+
+    if (precision < 0) {
+        append_shortest(out, x, format._leading_zero);
+        return;
+    }
+
+    assert(precision <= number_format::max_precision_k);
+
+    const auto scale{powers_of_ten_k[precision]};
+    const auto scaled{std::round(std::abs(x) * scale)};
+
+    // Past 2^53 the scaled value is no longer an exact integer; such magnitudes have no useful
+    // fractional digits anyway.
+    if (scaled >= 9007199254740992.) {
+        append_shortest(out, x, format._leading_zero);
+        return;
+    }
+
+    const auto n{static_cast<std::uint64_t>(scaled)};
+
+    if (!n) {
+        out += '0';
+        return;
+    }
+
+    if (x < 0) out += '-';
+
+    if (n >= scale || format._leading_zero) {
+        append_unsigned(out, n / scale);
+    }
+
+    auto fraction{n % scale};
+
+    if (!fraction) return;
+
+    int decimals{precision};
+
+    while (fraction % 10 == 0) {
+        fraction /= 10;
+        --decimals;
+    }
+
+    out += '.';
+
+    char buffer[number_format::max_precision_k];
+    for (int i{decimals}; i;) {
+        buffer[--i] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+
+    out.append(buffer, decimals);
+}
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
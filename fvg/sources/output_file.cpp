@@ -0,0 +1,188 @@
+/**************************************************************************************************/
+
+// stdc++
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#if __has_include(<unistd.h>)
+    #define FORESTVG_POSIX_IO() 1
+    #include <fcntl.h>
+    #include <unistd.h>
+#else
+    #define FORESTVG_POSIX_IO() 0
+#endif
+
+// zlib
+#include <zlib.h>
+
+// identity
+#include "output_file.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// Where the bytes go: the file at a path, or standard output. `close` reports what the
+// destructor (which only runs on the way out of an error) would swallow.
+#if FORESTVG_POSIX_IO()
+
+class output_sink {
+public:
+    explicit output_sink(const std::filesystem::path& path) :
+        _stdout{is_stdout_path(path)},
+        _fd{_stdout ? STDOUT_FILENO : ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666)} {
+        if (_fd == -1) {
+            throw std::runtime_error("error creating output file");
+        }
+    }
+
+    output_sink(const output_sink&) = delete;
+    output_sink& operator=(const output_sink&) = delete;
+
+    ~output_sink() {
+        if (!_stdout && _fd != -1) ::close(_fd);
+    }
+
+    void write(std::string_view bytes) {
+        // Pipes and sockets take partial writes; keep going until everything is through.
+        while (!bytes.empty()) {
+            const auto n{::write(_fd, bytes.data(), bytes.size())};
+
+            if (n > 0) {
+                bytes.remove_prefix(n);
+            } else if (n == -1 && errno == EINTR) {
+                continue;
+            } else {
+                throw std::runtime_error("error writing output file");
+            }
+        }
+    }
+
+    void close() {
+        if (_stdout) return;
+
+        const auto result{::close(_fd)};
+        _fd = -1;
+
+        if (result != 0) throw std::runtime_error("error writing output file");
+    }
+
+private:
+    bool _stdout;
+    int _fd;
+};
+
+#else
+
+class output_sink {
+public:
+    explicit output_sink(const std::filesystem::path& path) : _stdout{is_stdout_path(path)} {
+        if (_stdout) return;
+
+        _file.open(path, std::ios::out | std::ios::binary);
+
+        if (!_file) {
+            throw std::runtime_error("error creating output file");
+        }
+    }
+
+    void write(std::string_view bytes) {
+        auto& out{stream()};
+        out.write(bytes.data(), bytes.size());
+        if (!out) throw std::runtime_error("error writing output file");
+    }
+
+    void close() {
+        if (_stdout) {
+            std::cout.flush();
+        } else {
+            _file.close();
+        }
+
+        if (!stream()) throw std::runtime_error("error writing output file");
+    }
+
+private:
+    std::ostream& stream() { return _stdout ? std::cout : _file; }
+
+    bool _stdout;
+    std::ofstream _file;
+};
+
+#endif
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+void write_output(const std::filesystem::path& path, std::string_view bytes) {
+    output_sink out{path};
+    out.write(bytes);
+    out.close();
+}
+
+/**************************************************************************************************/
+
+void write_gzip_output(const std::filesystem::path& path, std::string_view bytes, int level) {
+    // 15 window bits, plus 16 for a gzip header and trailer instead of a zlib one.
+    constexpr int gzip_window_bits_k{15 + 16};
+    constexpr int memory_level_k{8};
+    constexpr std::size_t chunk_size_k{256 * 1024};
+
+    z_stream z{};
+
+    if (deflateInit2(&z, level, Z_DEFLATED, gzip_window_bits_k, memory_level_k,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("error initializing compression");
+    }
+
+    struct deflate_end {
+        z_stream& _z;
+        ~deflate_end() { deflateEnd(&_z); }
+    } end{z};
+
+    output_sink out{path};
+    std::string chunk(chunk_size_k, '\0');
+    int result{Z_OK};
+
+    // Each compressed chunk goes out as soon as it fills, so the compressed document is never
+    // held whole. zlib counts in uInt, so a document past 4GiB is fed in pieces.
+    while (result != Z_STREAM_END) {
+        if (!z.avail_in && !bytes.empty()) {
+            const auto n{std::min<std::size_t>(bytes.size(), UINT_MAX)};
+            z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(bytes.data()));
+            z.avail_in = static_cast<uInt>(n);
+            bytes.remove_prefix(n);
+        }
+
+        z.next_out = reinterpret_cast<Bytef*>(chunk.data());
+        z.avail_out = static_cast<uInt>(chunk.size());
+
+        result = deflate(&z, bytes.empty() ? Z_FINISH : Z_NO_FLUSH);
+
+        if (result == Z_STREAM_ERROR) {
+            throw std::runtime_error("error compressing output file");
+        }
+
+        out.write(std::string_view(chunk.data(), chunk.size() - z.avail_out));
+    }
+
+    out.close();
+}
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
@@ -1,5 +1,8 @@
 /**************************************************************************************************/
 
+// stdc++
+#include <vector>
+
 // identity
 #include "state.hpp"
 
@@ -12,20 +15,44 @@ namespace fvg {
 namespace detail {
 
 /**************************************************************************************************/
+// One pending JSON array: where its next element is, where its nodes go, and the node most
+// recently inserted there (the parent of a nested array that follows it).
+struct forest_frame {
+    json_array::const_iterator _first;
+    json_array::const_iterator _last;
+    node_iterator _p;
+    node_iterator _last_node;
+};
+
+// Iterative, with an explicit stack of frames, so nesting depth is bounded only by memory.
+void make_state_forest(name_table& names,
+                       node_forest& f,
+                       node_iterator p,
+                       const json_array& array) {
+    std::vector<forest_frame> stack{{array.begin(), array.end(), p, f.end()}};
+
+    while (!stack.empty()) {
+        auto& frame{stack.back()};
+
+        if (frame._first == frame._last) {
+            stack.pop_back();
+            continue;
+        }
+
+        const auto& n{*frame._first++};
 
-void make_state_forest(node_forest& f, node_iterator p, const json_array& array) {
-    node_iterator last_node{f.end()};
-    for (const auto& n : array) {
         if (n.is_string()) {
-            last_node = f.insert(p, as<std::string>(n));
+            frame._last_node = f.insert(frame._p, names.intern(as<std::string>(n)));
         } else if (n.is_array()) {
-            if (last_node == f.end()) {
+            if (frame._last_node == f.end()) {
                 throw std::runtime_error("children missing parent definition");
             }
 
-            make_state_forest(f, stlab::trailing_of(last_node), as<json_array>(n));
+            const auto& children{as<json_array>(n)};
+            const auto parent{stlab::trailing_of(frame._last_node)};
 
-            last_node = f.end();
+            frame._last_node = f.end();
+            stack.push_back({children.begin(), children.end(), parent, f.end()});
         } else {
             throw std::runtime_error("unexpected node type; must be string or array");
         }
@@ -38,10 +65,10 @@ void make_state_forest(node_forest& f, node_iterator p, const json_array& array)
 
 /**************************************************************************************************/
 
-auto make_state_forest(const json_array& array) {
+auto make_state_forest(name_table& names, const json_array& array) {
     node_forest result;
 
-    detail::make_state_forest(result, result.begin(), array);
+    detail::make_state_forest(names, result, result.begin(), array);
 
     return result;
 }
@@ -90,7 +117,7 @@ bool maybe_get(extents& f, const json_t& j, const std::string& k) {
 
 /**************************************************************************************************/
 
-auto make_state_nodes(const json_object& object) {
+auto make_state_nodes(name_table& names, const json_object& object) {
     node_map result;
 
     for (const auto& entry : object) {
@@ -105,7 +132,7 @@ auto make_state_nodes(const json_object& object) {
         maybe_get(value._color, mapped, "color");
         maybe_get(value._stroke_dasharray, mapped, "stroke-dasharray");
 
-        result[entry.first] = std::move(value);
+        result[names.intern(entry.first)] = std::move(value);
     }
 
     return result;
@@ -113,7 +140,7 @@ auto make_state_nodes(const json_object& object) {
 
 /**************************************************************************************************/
 
-auto make_state_edges(const json_object& object) {
+auto make_state_edges(name_table& names, const json_object& object) {
     edge_map result;
 
     for (const auto& entry : object) {
@@ -132,7 +159,7 @@ auto make_state_edges(const json_object& object) {
         maybe_get(value._label_offset, mapped, "label_offset");
         maybe_get(value._text_anchor, mapped, "text-anchor");
 
-        result[entry.first] = std::move(value);
+        result[names.intern(entry.first)] = std::move(value);
     }
 
     return result;
@@ -140,7 +167,7 @@ auto make_state_edges(const json_object& object) {
 
 /**************************************************************************************************/
 
-auto make_state_edge_labels(const json_array& array) {
+auto make_state_edge_labels(name_table& names, const json_array& array) {
     edge_labels result;
 
     for (const auto& l : array) {
@@ -148,7 +175,7 @@ auto make_state_edge_labels(const json_array& array) {
             throw std::runtime_error("string expected for edge label");
         }
 
-        result.push_back(as<std::string>(l));
+        result.push_back(names.intern(as<std::string>(l)));
     }
 
     return result;
@@ -156,9 +183,23 @@ auto make_state_edge_labels(const json_array& array) {
 
 /**************************************************************************************************/
 
+template <>
+bool maybe_get(layout_style& f, const json_t& j, const std::string& k) {
+    std::string name;
+
+    if (!maybe_get(name, j, k)) return false;
+
+    f = to_layout_style(name);
+
+    return true;
+}
+
+/**************************************************************************************************/
+
 auto make_state_graph_settings(const json_object& object) {
     graph_settings result;
 
+    maybe_get(result._layout, object, "layout");
     maybe_get(result._with_root, object, "with_root");
     maybe_get(result._with_leaf_edges, object, "with_leaf_edges");
     maybe_get(result._with_root_top, object, "with_root_top");
@@ -169,14 +210,25 @@ auto make_state_graph_settings(const json_object& object) {
 
 /**************************************************************************************************/
 
+layout_style to_layout_style(std::string_view name) {
+    if (name.empty() || name == "widths") return layout_style::widths;
+    if (name == "tidy") return layout_style::tidy;
+
+    throw std::runtime_error("unknown layout; must be \"widths\" or \"tidy\"");
+}
+
+/**************************************************************************************************/
+
 state make_state(const json_t& j) {
-    return {
-        make_state_forest(get<json_array>(j, "forest")),
-        make_state_nodes(get<json_object>(j, "nodes")),
-        make_state_edges(get<json_object>(j, "edges")),
-        make_state_edge_labels(get<json_array>(j, "edge_labels")),
-        make_state_graph_settings(get<json_object>(j, "settings")),
-    };
+    state result;
+
+    result._f = make_state_forest(result._names, get<json_array>(j, "forest"));
+    result._n = make_state_nodes(result._names, get<json_object>(j, "nodes"));
+    result._e = make_state_edges(result._names, get<json_object>(j, "edges"));
+    result._l = make_state_edge_labels(result._names, get<json_array>(j, "edge_labels"));
+    result._s = make_state_graph_settings(get<json_object>(j, "settings"));
+
+    return result;
 }
 
 /**************************************************************************************************/
@@ -0,0 +1,425 @@
+/**************************************************************************************************/
+
+// stdc++
+#include <optional>
+
+// identity
+#include "state.hpp"
+
+// application
+#include "mapped_file.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+/*
+    Builds a `state` from parser events as they arrive, without a json_t in between. Names are
+    interned straight out of the parser's string buffer.
+
+    It accepts what `make_state` accepts, with the same results: unknown keys are skipped
+    (whatever their value), a null property takes its type's default, a non-numeric value for a
+    numeric property reads as 0, and a repeated key replaces the earlier one.
+*/
+class state_sax final : public nlohmann::json_sax<json_t> {
+public:
+    state take() { return std::move(_state); }
+
+    bool null() override { return scalar(value()); }
+    bool boolean(bool x) override { return scalar(value(x)); }
+    bool number_integer(number_integer_t x) override { return number(static_cast<double>(x)); }
+    bool number_unsigned(number_unsigned_t x) override { return number(static_cast<double>(x)); }
+    bool number_float(number_float_t x, const string_t&) override { return number(x); }
+    bool string(string_t& x) override { return scalar(value(std::move(x))); }
+    bool binary(binary_t&) override { return scalar(value()); }
+
+    bool key(string_t& x) override {
+        _key = std::move(x);
+        return true;
+    }
+
+    bool start_object(std::size_t) override { return start(true); }
+    bool end_object() override { return end(); }
+    bool start_array(std::size_t) override { return start(false); }
+    bool end_array() override { return end(); }
+
+    bool parse_error(std::size_t,
+                     const std::string&,
+                     const nlohmann::detail::exception& error) override {
+        throw std::runtime_error(error.what());
+    }
+
+private:
+    enum class context {
+        document, // outside of any container
+        top,      // the top-level object
+        forest,   // a forest array, at any depth
+        nodes,    // the "nodes" object
+        node,     // one entry of "nodes"
+        edges,    // the "edges" object
+        edge,     // one entry of "edges"
+        labels,   // the "edge_labels" array
+        settings, // the "settings" object
+        skip,     // a container nothing is read from
+    };
+
+    struct frame {
+        context _context;
+        node_iterator _parent{}; // forest only: where the next node at this level goes
+        node_iterator _last{};   // forest only: the last node inserted at this level
+    };
+
+    // A scalar, as `make_state` would see it through json_t.
+    struct value {
+        enum class kind { null, boolean, number, string, container };
+
+        value() = default;
+        explicit value(bool x) : _kind{kind::boolean}, _bool{x} {}
+        explicit value(double x) : _kind{kind::number}, _number{x} {}
+        explicit value(std::string x) : _kind{kind::string}, _string{std::move(x)} {}
+        explicit value(kind k) : _kind{k} {}
+
+        kind _kind{kind::null};
+        bool _bool{false};
+        double _number{0};
+        std::string _string;
+    };
+
+    // The margin keys of the settings, in the order `make_state` applies them.
+    enum margin_key { margin, width, height, left, top, right, bottom, margin_key_count };
+
+    context current() const {
+        return _stack.empty() ? context::document : _stack.back()._context;
+    }
+
+    void push(context c) { _stack.push_back(frame{c}); }
+
+    bool number(double x) { return scalar(value(x)); }
+    void top_level_scalar(const value& x);
+    bool scalar(value x);
+    bool start(bool object);
+    bool end();
+
+    void node_property(value x);
+    void edge_property(value x);
+    void setting(value x);
+    void apply_margins();
+
+    bool as_bool(const value& x) const;
+    std::string as_string(value&& x) const;
+    static double as_number(const value& x) { return x._number; }
+
+    state _state;
+    std::vector<frame> _stack;
+    std::string _key;
+    std::string _entry; // the name of the node or edge whose properties are being read
+    node_properties _node;
+    edge_properties _edge;
+    std::optional<double> _margins[margin_key_count];
+};
+
+/**************************************************************************************************/
+
+bool state_sax::scalar(value x) {
+    switch (current()) {
+        case context::document:
+        case context::skip: {
+        } break;
+        case context::top: {
+            top_level_scalar(x);
+        } break;
+        case context::forest: {
+            if (x._kind != value::kind::string) {
+                throw std::runtime_error("unexpected node type; must be string or array");
+            }
+
+            auto& level{_stack.back()};
+            level._last =
+                _state._f.insert(level._parent, _state._names.intern(std::move(x._string)));
+        } break;
+        case context::nodes:
+        case context::edges: {
+            throw std::runtime_error("dictionary expected for node property");
+        } break;
+        case context::node: {
+            node_property(std::move(x));
+        } break;
+        case context::edge: {
+            edge_property(std::move(x));
+        } break;
+        case context::labels: {
+            if (x._kind != value::kind::string) {
+                throw std::runtime_error("string expected for edge label");
+            }
+
+            _state._l.push_back(_state._names.intern(std::move(x._string)));
+        } break;
+        case context::settings: {
+            setting(std::move(x));
+        } break;
+    }
+
+    return true;
+}
+
+/**************************************************************************************************/
+// A null section is an empty one; any other scalar is an error.
+void state_sax::top_level_scalar(const value& x) {
+    const bool null{x._kind == value::kind::null};
+
+    if (_key == "forest") {
+        if (null) _state._f.clear();
+    } else if (_key == "nodes") {
+        if (null) _state._n.clear();
+    } else if (_key == "edges") {
+        if (null) _state._e.clear();
+    } else if (_key == "edge_labels") {
+        if (null) _state._l.clear();
+    } else if (_key == "settings") {
+        if (null) _state._s = graph_settings();
+    } else {
+        return;
+    }
+
+    if (!null) {
+        throw std::runtime_error("\"" + _key + "\" has the wrong type");
+    }
+}
+
+/**************************************************************************************************/
+
+bool state_sax::start(bool object) {
+    const auto mismatch{[&](const char* expected) {
+        throw std::runtime_error("\"" + _key + "\" must be " + expected);
+    }};
+
+    switch (current()) {
+        case context::document: {
+            push(object ? context::top : context::skip);
+        } break;
+        case context::top: {
+            if (_key == "forest") {
+                if (object) mismatch("an array");
+                _state._f.clear();
+                _stack.push_back(frame{context::forest, _state._f.end(), _state._f.end()});
+            } else if (_key == "nodes") {
+                if (!object) mismatch("an object");
+                _state._n.clear();
+                push(context::nodes);
+            } else if (_key == "edges") {
+                if (!object) mismatch("an object");
+                _state._e.clear();
+                push(context::edges);
+            } else if (_key == "edge_labels") {
+                if (object) mismatch("an array");
+                _state._l.clear();
+                push(context::labels);
+            } else if (_key == "settings") {
+                if (!object) mismatch("an object");
+                _state._s = graph_settings();
+                for (auto& m : _margins) m.reset();
+                push(context::settings);
+            } else {
+                push(context::skip);
+            }
+        } break;
+        case context::forest: {
+            if (object) {
+                throw std::runtime_error("unexpected node type; must be string or array");
+            }
+
+            const auto last{_stack.back()._last};
+
+            if (last == _state._f.end()) {
+                throw std::runtime_error("children missing parent definition");
+            }
+
+            _stack.push_back(frame{context::forest, stlab::trailing_of(last), _state._f.end()});
+        } break;
+        case context::nodes:
+        case context::edges: {
+            if (!object) {
+                throw std::runtime_error("dictionary expected for node property");
+            }
+
+            _entry = std::move(_key);
+
+            if (current() == context::nodes) {
+                _node = node_properties();
+                push(context::node);
+            } else {
+                _edge = edge_properties();
+                push(context::edge);
+            }
+        } break;
+        case context::labels: {
+            throw std::runtime_error("string expected for edge label");
+        } break;
+        case context::node:
+        case context::edge:
+        case context::settings: {
+            // A container where a property belongs is read as a value of the wrong type.
+            scalar(value(value::kind::container));
+            push(context::skip);
+        } break;
+        case context::skip: {
+            push(context::skip);
+        } break;
+    }
+
+    return true;
+}
+
+/**************************************************************************************************/
+
+bool state_sax::end() {
+    const auto done{_stack.back()._context};
+
+    _stack.pop_back();
+
+    switch (done) {
+        case context::forest: {
+            // Children close off their parent; the next level-up array needs a new one.
+            if (current() == context::forest) {
+                _stack.back()._last = _state._f.end();
+            }
+        } break;
+        case context::node: {
+            _state._n[_state._names.intern(std::move(_entry))] = std::move(_node);
+        } break;
+        case context::edge: {
+            _state._e[_state._names.intern(std::move(_entry))] = std::move(_edge);
+        } break;
+        case context::settings: {
+            apply_margins();
+        } break;
+        default: {
+        } break;
+    }
+
+    return true;
+}
+
+/**************************************************************************************************/
+
+void state_sax::node_property(value x) {
+    if (_key == "color") {
+        _node._color = as_string(std::move(x));
+    } else if (_key == "stroke-dasharray") {
+        _node._stroke_dasharray = as_string(std::move(x));
+    }
+}
+
+/**************************************************************************************************/
+
+void state_sax::edge_property(value x) {
+    if (_key == "hide") {
+        _edge._hide = as_bool(x);
+    } else if (_key == "color") {
+        _edge._color = as_string(std::move(x));
+    } else if (_key == "t") {
+        _edge._t = as_number(x);
+    } else if (_key == "stroke-dasharray") {
+        _edge._stroke_dasharray = as_string(std::move(x));
+    } else if (_key == "label_offset") {
+        _edge._label_offset = as_number(x);
+    } else if (_key == "text-anchor") {
+        _edge._text_anchor = as_string(std::move(x));
+    }
+}
+
+/**************************************************************************************************/
+
+void state_sax::setting(value x) {
+    static const char* const margin_keys_k[]{
+        "margin",      "margin_width", "margin_height", "margin_left",
+        "margin_top", "margin_right", "margin_bottom",
+    };
+
+    if (_key == "layout") {
+        _state._s._layout = to_layout_style(as_string(std::move(x)));
+    } else if (_key == "with_root") {
+        _state._s._with_root = as_bool(x);
+    } else if (_key == "with_leaf_edges") {
+        _state._s._with_leaf_edges = as_bool(x);
+    } else if (_key == "with_root_top") {
+        _state._s._with_root_top = as_bool(x);
+    } else {
+        for (std::size_t i{0}; i < margin_key_count; ++i) {
+            if (_key == margin_keys_k[i]) {
+                _margins[i] = as_number(x);
+                break;
+            }
+        }
+    }
+}
+
+/**************************************************************************************************/
+
+void state_sax::apply_margins() {
+    auto& m{_state._s._margin};
+
+    if (const auto& x{_margins[margin]}) m = extents{*x, *x, *x, *x};
+    if (const auto& x{_margins[width]}) m.l = m.r = *x;
+    if (const auto& x{_margins[height]}) m.t = m.b = *x;
+    if (const auto& x{_margins[left]}) m.l = *x;
+    if (const auto& x{_margins[top]}) m.t = *x;
+    if (const auto& x{_margins[right]}) m.r = *x;
+    if (const auto& x{_margins[bottom]}) m.b = *x;
+}
+
+/**************************************************************************************************/
+
+bool state_sax::as_bool(const value& x) const {
+    if (x._kind != value::kind::null && x._kind != value::kind::boolean) {
+        throw std::runtime_error("\"" + _key + "\" must be a boolean");
+    }
+
+    return x._bool;
+}
+
+/**************************************************************************************************/
+
+std::string state_sax::as_string(value&& x) const {
+    if (x._kind != value::kind::null && x._kind != value::kind::string) {
+        throw std::runtime_error("\"" + _key + "\" must be a string");
+    }
+
+    return std::move(x._string);
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+state parse_state(const char* first, const char* last) {
+    state_sax sax;
+
+    // An empty file is an empty graph, as it is for `slurp_json`.
+    if (first != last) {
+        json_t::sax_parse(first, last, &sax);
+    }
+
+    return sax.take();
+}
+
+/**************************************************************************************************/
+
+state slurp_state(const std::filesystem::path& path, file_access access) {
+    const mapped_file input{path, access};
+
+    return parse_state(input.begin(), input.end());
+}
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
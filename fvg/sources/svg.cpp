@@ -1,14 +1,628 @@
 /**************************************************************************************************/
 
+// stdc++
+#include <array>
+#include <cctype>
+#include <cmath>
+
 // identity
 #include "svg.hpp"
 
 /**************************************************************************************************/
 
 namespace fvg {
+namespace svg {
+
+/**************************************************************************************************/
+
+namespace {
+
+/**************************************************************************************************/
+// An arrowhead is a triangle on its base, pointing along its normal.
+constexpr double arrowhead_half_base_k{5};
+constexpr double arrowhead_length_k{12};
+
+constexpr double degrees_per_radian_k{180 / M_PI};
+
+/**************************************************************************************************/
+
+std::array<point, 3> corners(const arrowhead& a) {
+    const point perp{-a._n.y, a._n.x};
+    return {a._p - perp * arrowhead_half_base_k,
+            a._p + a._n * arrowhead_length_k,
+            a._p + perp * arrowhead_half_base_k};
+}
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+void translate(node& n, const point& d) {
+    struct {
+        const point& _d;
+
+        void operator()(line& l) const {
+            l._a += _d;
+            l._b += _d;
+        }
+        void operator()(cubic_path& p) const {
+            p._b._s += _d;
+            p._b._c1 += _d;
+            p._b._c2 += _d;
+            p._b._e += _d;
+        }
+        void operator()(text& t) const { t._p += _d; }
+        void operator()(circle& c) const { c._c += _d; }
+        void operator()(square& s) const { s._p += _d; }
+        void operator()(arrowhead& a) const { a._p += _d; }
+    } visitor{d};
+
+    std::visit(visitor, n);
+}
+
+/**************************************************************************************************/
+
+writer::writer(std::string& out, const writer_options& options) :
+    _out{out}, _format{options._numbers}, _minify{options._minify},
+    _shared_shapes{options._shared_shapes}, _style_classes{options._style_classes},
+    _coalesce_edges{options._coalesce_edges} {
+    if (_minify) _format._leading_zero = false;
+}
+
+/**************************************************************************************************/
+
+void writer::begin(double width, double height) {
+    if (!_minify) _out += "<?xml version='1.0' encoding='utf-8'?>\n";
+
+    open_tag("svg");
+    attribute("xmlns", "http://www.w3.org/2000/svg");
+    attribute("xmlns:xlink", "http://www.w3.org/1999/xlink");
+    attribute("width", width);
+    attribute("height", height);
+    _out += '>';
+    newline();
+
+    ++_depth;
+
+    _head_at = _out.size();
+}
+
+/**************************************************************************************************/
+
+void writer::end() {
+    if (_pending_edges) flush_edges();
+
+    if (_classes.size() > 1 || _defs.size() > 1) write_head();
+
+    --_depth;
+
+    indent();
+    _out += "</svg>";
+    newline();
+}
+
+/**************************************************************************************************/
+
+void writer::write(const node& n) {
+    std::visit([this](const auto& n) { write(n); }, n);
+}
+
+/**************************************************************************************************/
+
+void writer::write(const line& l) {
+    if (_pending_edges) flush_edges();
+
+    open_tag("line");
+    attribute("x1", l._a.x);
+    attribute("y1", l._a.y);
+    attribute("x2", l._b.x);
+    attribute("y2", l._b.y);
+
+    const auto at{_out.size()};
+    attribute("stroke", l._color);
+    attribute("stroke-width", l._width);
+    classify(at);
+
+    close_empty_tag();
+}
+
+/**************************************************************************************************/
+
+void writer::write(const cubic_path& p) {
+    if (_coalesce_edges && p._id == name_table::empty_k) {
+        const auto at{_out.size()};
+        attribute("stroke", p._color);
+        attribute("stroke-linecap", "round");
+        attribute("fill", "none");
+        attribute("stroke-width", p._width);
+        attribute("stroke-dasharray", p._stroke_dasharray, "0");
+
+        const auto data_at{_out.size()};
+        path_data(p._b);
+
+        coalesce(at, data_at);
+        return;
+    }
+
+    open_tag("path");
+
+    _out += " d='";
+    path_data(p._b);
+    _out += '\'';
+
+    const auto at{_out.size()};
+    attribute("stroke", p._color);
+    attribute("stroke-linecap", "round");
+    attribute("fill", "none");
+    attribute("stroke-width", p._width);
+    attribute("stroke-dasharray", p._stroke_dasharray, "0");
+    classify(at);
+
+    close_empty_tag();
+}
+
+/**************************************************************************************************/
+
+void writer::write(const text& t) {
+    if (_pending_edges) flush_edges();
+
+    open_tag("text");
+
+    const auto at{_out.size()};
+    attribute("font-size", t._size);
+    attribute("text-anchor", t._text_anchor, "start");
+    attribute("dominant-baseline", "central");
+
+    if (_style_classes) {
+        // The position goes after the rest, so what `classify` takes is in one piece.
+        attribute("fill", t._color, "black");
+        classify(at);
+        attribute("x", t._p.x);
+        attribute("y", t._p.y);
+    } else {
+        attribute("x", t._p.x);
+        attribute("y", t._p.y);
+        attribute("fill", t._color, "black");
+    }
+
+    _out += '>';
+    newline();
+
+    _out += t._s;
+    _out += "<tspan dy='";
+    number(t._size / 2);
+    _out += "' font-size='.7em'>";
+    _out += t._subscript;
+    _out += "</tspan>";
+    newline();
+
+    indent();
+    _out += "</text>";
+    newline();
+}
+
+/**************************************************************************************************/
+
+void writer::write(const circle& c) {
+    if (_pending_edges) flush_edges();
+
+    if (_shared_shapes) {
+        const auto at{_out.size()};
+        attribute("r", c._r);
+        attribute("fill", "white");
+        attribute("stroke", c._color);
+        attribute("stroke-width", c._stroke_width);
+        attribute("stroke-dasharray", c._stroke_dasharray, "0");
+
+        use(define("circle", at));
+        attribute("x", c._c.x);
+        attribute("y", c._c.y);
+        close_empty_tag();
+        return;
+    }
+
+    open_tag("circle");
+    attribute("cx", c._c.x);
+    attribute("cy", c._c.y);
+    attribute("r", c._r);
+
+    const auto at{_out.size()};
+    attribute("fill", "white");
+    attribute("stroke", c._color);
+    attribute("stroke-width", c._stroke_width);
+    attribute("stroke-dasharray", c._stroke_dasharray, "0");
+    classify(at);
+
+    close_empty_tag();
+}
+
+/**************************************************************************************************/
+
+void writer::write(const square& s) {
+    if (_pending_edges) flush_edges();
+
+    if (_shared_shapes) {
+        const auto at{_out.size()};
+        attribute("width", s._size);
+        attribute("height", s._size);
+        attribute("fill", "white");
+        attribute("stroke", s._color);
+        attribute("stroke-width", s._stroke_width);
+
+        use(define("rect", at));
+        attribute("x", s._p.x);
+        attribute("y", s._p.y);
+        close_empty_tag();
+        return;
+    }
+
+    open_tag("rect");
+    attribute("x", s._p.x);
+    attribute("y", s._p.y);
+    attribute("width", s._size);
+    attribute("height", s._size);
+
+    const auto at{_out.size()};
+    attribute("fill", "white");
+    attribute("stroke", s._color);
+    attribute("stroke-width", s._stroke_width);
+    classify(at);
+
+    close_empty_tag();
+}
+
+/**************************************************************************************************/
+
+void writer::write(const arrowhead& a) {
+    if (_coalesce_edges) {
+        const auto at{_out.size()};
+        attribute("fill", a._color, "black");
+        attribute("stroke", "none", "none");
+
+        const auto data_at{_out.size()};
+        arrowhead_data(a);
+
+        coalesce(at, data_at);
+        return;
+    }
+
+    if (_shared_shapes) {
+        // Defined pointing along +x with its base centered on the origin, then turned to the
+        // normal and moved into place.
+        const auto at{_out.size()};
+        _out += " points='";
+        coordinates(point{0, -arrowhead_half_base_k});
+        if (!_minify) _out += ',';
+        separated_number(arrowhead_length_k);
+        separated_number(0);
+        if (!_minify) _out += ',';
+        separated_number(0);
+        separated_number(arrowhead_half_base_k);
+        _out += '\'';
+        attribute("fill", a._color, "black");
+        attribute("stroke", "none", "none");
+
+        use(define("polygon", at));
+        _out += " transform='translate(";
+        coordinates(a._p);
+        _out += _minify ? ")rotate(" : ") rotate(";
+        number(std::atan2(a._n.y, a._n.x) * degrees_per_radian_k);
+        _out += ")'";
+        close_empty_tag();
+        return;
+    }
+
+    const auto [p0, p1, p2]{corners(a)};
+
+    open_tag("polygon");
+
+    _out += " points='";
+    coordinates(p0);
+    if (!_minify) _out += ',';
+    separated_number(p1.x);
+    separated_number(p1.y);
+    if (!_minify) _out += ',';
+    separated_number(p2.x);
+    separated_number(p2.y);
+    _out += '\'';
+
+    const auto at{_out.size()};
+    attribute("fill", a._color, "black");
+    attribute("stroke", "none", "none");
+    classify(at);
+
+    close_empty_tag();
+}
+
+/**************************************************************************************************/
+
+void writer::indent() {
+    if (_minify) return;
+
+    // One append of a ready-made run of spaces; anything deeper than that is never nested here.
+    static constexpr std::string_view spaces_k{"                                "};
+    const auto n{_depth * 4};
+
+    if (n <= spaces_k.size()) {
+        _out.append(spaces_k.data(), n);
+    } else {
+        _out.append(n, ' ');
+    }
+}
+
+/**************************************************************************************************/
+
+name_id writer::define(const char* tag, std::size_t at) {
+    _def_key.assign(tag);
+    _def_key.append(_out, at, std::string::npos);
+    _out.resize(at);
+
+    return _defs.intern(std::string_view(_def_key));
+}
+
+/**************************************************************************************************/
+
+void writer::use(name_id def) {
+    open_tag("use");
+    _out += " xlink:href='#d";
+    _out += std::to_string(def);
+    _out += '\'';
+}
+
+/**************************************************************************************************/
+
+void writer::classify(std::size_t at) {
+    if (!_style_classes || at == _out.size()) return;
+
+    // Looked up in place; only a set not seen before is copied.
+    const auto id{_classes.intern(std::string_view(_out).substr(at))};
+
+    _out.resize(at);
+    _out += " class='s";
+    _out += std::to_string(id);
+    _out += '\'';
+}
+
+/**************************************************************************************************/
+
+void writer::coalesce(std::size_t at, std::size_t data_at) {
+    const auto id{_edge_styles.intern(std::string_view(_out).substr(at, data_at - at))};
+
+    if (id >= _edge_groups.size()) _edge_groups.resize(id + 1);
+
+    auto& group{_edge_groups[id]};
+
+    if (!_minify && !group.empty()) group += ' ';
+    group.append(_out, data_at, std::string::npos);
+
+    _out.resize(at);
+    _pending_edges = true;
+}
+
+/**************************************************************************************************/
+// Groups go out in the order their looks first came up. The one exception is the empty look, of
+// arrowheads minified down to the initial values: `name_table` keeps it at `empty_k`, and it goes
+// last so the arrowheads stay on top of their edges.
+void writer::flush_edges() {
+    _pending_edges = false;
+
+    const auto n{static_cast<name_id>(_edge_groups.size())};
+
+    for (name_id i{1}; i <= n; ++i) {
+        const auto id{i == n ? name_table::empty_k : i};
+        auto& group{_edge_groups[id]};
+
+        if (group.empty()) continue;
+
+        open_tag("path");
+
+        _out += " d='";
+        _out += group;
+        _out += '\'';
+
+        const auto at{_out.size()};
+        _out += _edge_styles[id];
+        classify(at);
+
+        close_empty_tag();
+
+        group.clear();
+    }
+}
+
+/**************************************************************************************************/
+// Known only once the last element is written, but placed first: after all of the elements have
+// been serialized, the <style> and <defs> are put together on their own and spliced in after
+// <svg>.
+void writer::write_head() {
+    std::string body;
+    body.swap(_out);
+
+    if (_classes.size() > 1) write_style();
+    if (_defs.size() > 1) write_defs();
+
+    body.insert(_head_at, _out);
+    body.swap(_out);
+}
+
+/**************************************************************************************************/
+
+void writer::write_style() {
+    open_tag("style");
+    _out += '>';
+    newline();
+
+    ++_depth;
+
+    for (name_id id{1}, n{static_cast<name_id>(_classes.size())}; id < n; ++id) {
+        // The attributes as written, " name='value'" each, are the declarations of the rule.
+        std::string_view attributes{_classes[id]};
+
+        indent();
+        _out += ".s";
+        _out += std::to_string(id);
+        _out += '{';
+
+        for (bool first{true}; !attributes.empty(); first = false) {
+            const auto equals{attributes.find('=')};
+            const auto close{attributes.find('\'', equals + 2)};
+
+            const auto name{attributes.substr(1, equals - 1)};
+            const auto value{attributes.substr(equals + 2, close - equals - 2)};
+
+            if (!first) _out += ';';
+            _out += name;
+            _out += ':';
+            _out += value;
+
+            // Unlike the attribute, the property takes no bare number.
+            if (name == "font-size" && std::isdigit(static_cast<unsigned char>(value.back()))) {
+                _out += "px";
+            }
+
+            attributes.remove_prefix(close + 1);
+        }
+
+        _out += '}';
+        newline();
+    }
+
+    --_depth;
+
+    indent();
+    _out += "</style>";
+    newline();
+}
+
+/**************************************************************************************************/
+
+void writer::write_defs() {
+    open_tag("defs");
+    _out += '>';
+    newline();
+
+    ++_depth;
+
+    for (name_id id{1}, n{static_cast<name_id>(_defs.size())}; id < n; ++id) {
+        const std::string_view def{_defs[id]};
+        const auto tag_end{def.find(' ')};
+
+        indent();
+        _out += '<';
+        _out += def.substr(0, tag_end);
+        _out += " id='d";
+        _out += std::to_string(id);
+        _out += '\'';
+        _out += def.substr(tag_end);
+        close_empty_tag();
+    }
+
+    --_depth;
+
+    indent();
+    _out += "</defs>";
+    newline();
+}
+
+/**************************************************************************************************/
+
+void writer::newline() {
+    if (!_minify) _out += '\n';
+}
+
+/**************************************************************************************************/
+
+void writer::open_tag(const char* tag) {
+    indent();
+    _out += '<';
+    _out += tag;
+}
+
+/**************************************************************************************************/
+
+void writer::attribute(const char* name, std::string_view value) {
+    _out += ' ';
+    _out += name;
+    _out += "='";
+    _out += value;
+    _out += '\'';
+}
+
+/**************************************************************************************************/
+
+void writer::close_empty_tag() {
+    _out += "/>";
+    newline();
+}
+
+/**************************************************************************************************/
+
+void writer::attribute(const char* name, std::string_view value, std::string_view initial) {
+    if (_minify && value == initial) return;
+
+    attribute(name, value);
+}
+
+/**************************************************************************************************/
+
+void writer::attribute(const char* name, double value) {
+    _out += ' ';
+    _out += name;
+    _out += "='";
+    number(value);
+    _out += '\'';
+}
+
+/**************************************************************************************************/
+
+void writer::separated_number(double x) {
+    const auto at{_out.size()};
+
+    _out += ' ';
+    number(x);
+
+    if (_minify && _out[at + 1] == '-') _out.erase(at, 1);
+}
+
+/**************************************************************************************************/
+
+void writer::coordinates(const point& p) {
+    number(p.x);
+    separated_number(p.y);
+}
+
+/**************************************************************************************************/
+
+void writer::path_data(const cubic_bezier& b) {
+    _out += _minify ? "M" : "M ";
+    coordinates(b._s);
+    _out += _minify ? "C" : " C";
+    coordinates(b._c1);
+    separated_number(b._c2.x);
+    separated_number(b._c2.y);
+    separated_number(b._e.x);
+    separated_number(b._e.y);
+}
+
+/**************************************************************************************************/
+
+void writer::arrowhead_data(const arrowhead& a) {
+    const auto [p0, p1, p2]{corners(a)};
+
+    _out += _minify ? "M" : "M ";
+    coordinates(p0);
+    _out += _minify ? "L" : " L";
+    coordinates(p1);
+    separated_number(p2.x);
+    separated_number(p2.y);
+    _out += _minify ? "Z" : " Z";
+}
 
 /**************************************************************************************************/
 
+} // namespace svg
 } // namespace fvg
 
 /**************************************************************************************************/
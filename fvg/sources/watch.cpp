@@ -0,0 +1,286 @@
+/**************************************************************************************************/
+
+// stdc++
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if __has_include(<sys/inotify.h>)
+    #define FORESTVG_INOTIFY() 1
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#else
+    #define FORESTVG_INOTIFY() 0
+#endif
+
+// stlab
+#include <stlab/concurrency/default_executor.hpp>
+#include <stlab/concurrency/future.hpp>
+#include <stlab/concurrency/system_timer.hpp>
+
+// identity
+#include "watch.hpp"
+
+// application
+#include "manifest.hpp"
+
+/**************************************************************************************************/
+
+namespace fvg {
+
+/**************************************************************************************************/
+
+#if FORESTVG_INOTIFY()
+
+namespace {
+
+/**************************************************************************************************/
+// How long a file has to be left alone before it is rendered again. Long enough to span the
+// writes of one save, short enough not to be noticed.
+constexpr std::chrono::milliseconds debounce_k{100};
+
+using std::chrono::steady_clock;
+
+/**************************************************************************************************/
+
+bool watched(const std::string& name) {
+    return !name.empty() && name.front() != '.' && name.back() != '~';
+}
+
+/**************************************************************************************************/
+/*
+    The files that changed since the last render (`_pending`, each with the time its quiet period
+    ends) and the ones being rendered (`_running`). Every change of a file pushes its own deadline
+    back and sets off a timer; whenever one goes off, the files that are past their deadline and
+    not already running go to the executor, so a file that keeps changing holds up no other. A
+    file that changes while it renders waits for that render to finish and goes again after it.
+
+    Inputs are read, not mapped: an editor may truncate a file while it is being rendered. A
+    file that is gone by the time it would render takes its output (and manifest entry) with it.
+
+    Shared with the timer and the renders, which can outlive a throwing `watch_directory`.
+*/
+class watcher : public std::enable_shared_from_this<watcher> {
+public:
+    watcher(std::filesystem::path srcdir,
+            std::filesystem::path dstdir,
+            write_options options,
+            std::function<void(const batch_error&)> report) :
+        _srcdir{std::move(srcdir)}, _dstdir{std::move(dstdir)}, _options{std::move(options)},
+        _report{std::move(report)},
+        _manifest{_dstdir / render_manifest::file_name_k, settings_hash(_options)} {}
+
+    void changed(std::string name) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        const auto deadline{steady_clock::now() + debounce_k};
+        _pending[std::move(name)] = deadline;
+        arm(deadline);
+    }
+
+    // For when changes were lost and it's anybody's guess which files they were.
+    void changed_all() {
+        std::error_code error;
+
+        for (const auto& entry : std::filesystem::directory_iterator{_srcdir, error}) {
+            auto name{entry.path().filename().string()};
+            if (watched(name)) changed(std::move(name));
+        }
+    }
+
+private:
+    // The timer counts on the same clock from a later now, so it goes off no sooner than
+    // `deadline` and `flush` finds the file due.
+    void arm(steady_clock::time_point deadline) {
+        stlab::system_timer(deadline - steady_clock::now(),
+                            [_self = shared_from_this()] { _self->flush(); });
+    }
+
+    void flush() {
+        std::vector<std::string> ready;
+
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            const auto now{steady_clock::now()};
+
+            for (auto first{_pending.begin()}; first != _pending.end();) {
+                if (first->second > now || _running.count(first->first)) {
+                    ++first;
+                } else {
+                    _running.insert(first->first);
+                    ready.push_back(first->first);
+                    first = _pending.erase(first);
+                }
+            }
+        }
+
+        for (auto& name : ready) {
+            stlab::async(stlab::default_executor, [_self = shared_from_this(), _name = name] {
+                _self->render(_name);
+            }).detach();
+        }
+    }
+
+    void render(const std::string& name) {
+        const auto src{_srcdir / name};
+        const auto dst{output_path(_dstdir, src, _options)};
+        std::error_code error;
+
+        if (is_regular_file(src, error)) {
+            std::uint64_t hash{0};
+            auto what{render_file(src, dst, _options, file_access::copy, &hash)};
+
+            if (what.empty()) {
+                record(name, &hash);
+            } else {
+                record(name, nullptr);
+                report(batch_error{src, std::move(what)});
+            }
+        } else {
+            // Deleted or moved away (or never was a file) by the time the dust settled.
+            std::filesystem::remove(dst, error);
+            record(name, nullptr);
+        }
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        _running.erase(name);
+
+        // Changed while it rendered; goes again as soon as it has been quiet for long enough.
+        const auto found{_pending.find(name)};
+        if (found != _pending.end()) arm(found->second);
+    }
+
+    // Notes in the manifest what `name` was rendered from, or, with no `hash`, that its output
+    // (if any) isn't current.
+    void record(const std::string& name, const std::uint64_t* hash) {
+        const auto path{_dstdir / render_manifest::file_name_k};
+        std::lock_guard<std::mutex> lock{_manifest_mutex};
+
+        if (hash) {
+            _manifest.set(name, *hash);
+        } else {
+            _manifest.erase(name);
+        }
+
+        try {
+            _manifest.save(path);
+        } catch (const std::exception& error) {
+            report(batch_error{path, error.what()});
+        }
+    }
+
+    void report(const batch_error& error) {
+        std::lock_guard<std::mutex> lock{_report_mutex};
+        _report(error);
+    }
+
+    const std::filesystem::path _srcdir;
+    const std::filesystem::path _dstdir;
+    const write_options _options;
+    const std::function<void(const batch_error&)> _report;
+
+    std::mutex _mutex;
+    std::map<std::string, steady_clock::time_point> _pending;
+    std::set<std::string> _running;
+
+    std::mutex _report_mutex;
+
+    std::mutex _manifest_mutex;
+    render_manifest _manifest;
+};
+
+/**************************************************************************************************/
+
+struct inotify_handle {
+    inotify_handle() : _fd{::inotify_init1(IN_CLOEXEC)} {
+        if (_fd == -1) throw std::runtime_error("error starting to watch for changes");
+    }
+
+    inotify_handle(const inotify_handle&) = delete;
+    inotify_handle& operator=(const inotify_handle&) = delete;
+
+    ~inotify_handle() { ::close(_fd); }
+
+    int _fd;
+};
+
+/**************************************************************************************************/
+
+} // namespace
+
+/**************************************************************************************************/
+
+void watch_directory(const std::filesystem::path& srcdir,
+                     const std::filesystem::path& dstdir,
+                     const batch_options& options,
+                     const std::function<void(const batch_error&)>& report) {
+    constexpr std::uint32_t changes_k{IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM};
+    constexpr std::uint32_t gone_k{IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_UNMOUNT};
+
+    const inotify_handle inotify;
+
+    // Watch before the first render, so nothing saved during it goes unnoticed.
+    if (::inotify_add_watch(inotify._fd, srcdir.c_str(), changes_k | IN_DELETE_SELF |
+                                                             IN_MOVE_SELF) == -1) {
+        throw std::runtime_error("error watching " + srcdir.string());
+    }
+
+    auto copying{options};
+    copying._access = file_access::copy;
+
+    for (const auto& error : render_directory(srcdir, dstdir, copying)) {
+        report(error);
+    }
+
+    const auto files{std::make_shared<watcher>(srcdir, dstdir, options._write, report)};
+
+    alignas(inotify_event) char buffer[64 * 1024];
+
+    while (true) {
+        const auto n{::read(inotify._fd, buffer, sizeof(buffer))};
+
+        if (n == -1 && errno == EINTR) continue;
+
+        if (n <= 0) throw std::runtime_error("error watching " + srcdir.string());
+
+        for (auto p{buffer}; p < buffer + n;) {
+            const auto& event{*reinterpret_cast<const inotify_event*>(p)};
+            p += sizeof(inotify_event) + event.len;
+
+            if (event.mask & IN_Q_OVERFLOW) {
+                files->changed_all();
+            } else if (event.mask & gone_k) {
+                throw std::runtime_error("stopped watching " + srcdir.string() +
+                                         "; it was removed");
+            } else if ((event.mask & changes_k) && event.len) {
+                std::string name{event.name};
+                if (watched(name)) files->changed(std::move(name));
+            }
+        }
+    }
+}
+
+/**************************************************************************************************/
+
+#else
+
+void watch_directory(const std::filesystem::path&,
+                     const std::filesystem::path&,
+                     const batch_options&,
+                     const std::function<void(const batch_error&)>&) {
+    throw std::runtime_error("--watch is not supported on this platform");
+}
+
+#endif
+
+/**************************************************************************************************/
+
+} // namespace fvg
+
+/**************************************************************************************************/
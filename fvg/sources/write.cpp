@@ -1,15 +1,19 @@
 /**************************************************************************************************/
 
 // stdc++
-#include <fstream>
+#include <algorithm>
 #include <tuple>
+#include <utility>
 
 // identity
 #include "write.hpp"
 
 // application
+#include "flat_forest.hpp"
 #include "forest_algorithms.hpp"
 #include "geometry.hpp"
+#include "layout.hpp"
+#include "output_file.hpp"
 #include "svg.hpp"
 
 /**************************************************************************************************/
@@ -17,252 +21,14 @@
 namespace fvg {
 
 /**************************************************************************************************/
-// REVISIT: Hmmm, this is transcribe_forest, but with proj(first) instead of proj(*first).
-auto child_counts(const state& state) {
-    stlab::forest<std::size_t> result;
-    auto pos{result.root()};
-    auto first{state._f.begin()};
-    const auto last{state._f.end()};
 
-    while (first != last) {
-        ++pos;
-        if (stlab::is_leading(first)) {
-            auto child_count = std::distance(stlab::child_begin(first), stlab::child_end(first));
-            pos = result.insert(pos, child_count);
-        } else {
-            pos = stlab::trailing_of(pos);
-        }
-        ++first;
-    }
-
-    return result;
-}
-
-/**************************************************************************************************/
-
-constexpr auto node_size_k{50};
-constexpr auto node_radius_k{node_size_k / 2};
-constexpr auto node_spacing_k{25};
-constexpr auto tier_height_k{50};
 constexpr auto stroke_width_k{2};
+constexpr auto arrowhead_length_k{12}; // edges are trimmed back by this much for the arrowhead
 constexpr auto font_size_k{16};
 constexpr auto root_name_k{"&#x211C;"};
 
 /**************************************************************************************************/
 
-auto derive_widths(const stlab::forest<std::size_t>& counts) {
-    stlab::forest<std::size_t> result;
-    auto pos{result.root()};
-    auto first{counts.begin()};
-    const auto last{counts.end()};
-
-    while (first != last) {
-        ++pos;
-        if (stlab::is_leading(first)) {
-            pos = result.insert(pos, 0);
-        } else {
-            // now that all the children have gone, let's update our width
-            if (!stlab::has_children(pos)) {
-                *pos = node_size_k;
-            } else {
-                auto child_first{stlab::child_begin(pos)};
-                auto child_last{stlab::child_end(pos)};
-                while (child_first != child_last) {
-                    *pos += *child_first + node_spacing_k;
-                    ++child_first;
-                }
-                // pull out one spacing amount (it's between nodes, not one for each.)
-                *pos -= node_spacing_k;
-            }
-            pos = stlab::trailing_of(pos);
-        }
-        ++first;
-    }
-
-    return result;
-}
-
-/**************************************************************************************************/
-
-auto derive_height(const stlab::forest<std::size_t>& counts, bool leaf_edges, double margin_height) {
-    stlab::depth_fullorder_iterator first{counts.begin()};
-    stlab::depth_fullorder_iterator last{counts.end()};
-    decltype(first.depth()) max_depth{0};
-
-    while (first != last) {
-        if (stlab::is_leading(first)) {
-            max_depth = std::max(max_depth, first.depth());
-        }
-        ++first;
-    }
-
-    ++max_depth;
-
-    // Keep the extra node spacing for the leaf node edges on the bottom of the graph.
-    auto height{(tier_height_k + node_spacing_k) * max_depth};
-
-    // Unless, of course, there are no leaf edges.
-    if (!leaf_edges) {
-        height -= node_spacing_k;
-    }
-
-    return height + margin_height;
-}
-
-/**************************************************************************************************/
-
-auto derive_width(const stlab::forest<std::size_t>& widths, double margin_width) {
-    auto root{widths.root()};
-    auto first{stlab::child_begin(root)};
-    auto last{stlab::child_end(root)};
-    auto count{0};
-    auto result{0};
-
-    while (first != last) {
-        result += *first + node_spacing_k;
-
-        ++first;
-        ++count;
-    }
-
-    if (result) {
-        result -= node_spacing_k;
-    }
-
-    return result + margin_width;
-}
-
-/**************************************************************************************************/
-
-namespace detail {
-
-/**************************************************************************************************/
-
-void derive_x_offsets(stlab::forest<std::size_t>::const_iterator src,
-                      stlab::forest<std::size_t>::iterator dst,
-                      std::size_t parent_x_offset) {
-    // It is assumed that the src and dst forest have the same shape.
-    auto src_first{stlab::child_begin(src)};
-    auto src_last{stlab::child_end(src)};
-    auto dst_first{stlab::child_begin(dst)};
-
-    while (src_first != src_last) {
-        auto old_width{*dst_first};
-        *dst_first = parent_x_offset + (old_width - node_size_k) / 2;
-        derive_x_offsets(src_first.base(), dst_first.base(), parent_x_offset);
-        parent_x_offset += *src_first + node_spacing_k;
-        ++src_first;
-        ++dst_first;
-    }
-}
-
-/**************************************************************************************************/
-
-} // namespace detail
-
-/**************************************************************************************************/
-
-auto derive_x_offsets(const stlab::forest<std::size_t>& widths, double left_margin) {
-    stlab::forest<std::size_t> result{widths};
-    detail::derive_x_offsets(widths.root(), result.root(), left_margin);
-    return result;
-}
-
-/**************************************************************************************************/
-
-auto derive_y_offsets(const state& state, double margin_top) {
-    stlab::forest<std::size_t> result;
-    auto pos{result.root()};
-    stlab::depth_fullorder_iterator first{state._f.begin()};
-    stlab::depth_fullorder_iterator last{state._f.end()};
-
-    while (first != last) {
-        ++pos;
-        if (is_leading(first)) {
-            pos = result.insert(pos, margin_top + (tier_height_k + node_spacing_k) * first.depth());
-        }
-        ++first;
-    }
-
-    return result;
-}
-
-/**************************************************************************************************/
-
-struct xml_node {
-    std::string _tag;
-    std::unordered_map<std::string, std::string> _attributes;
-    std::string _content;
-};
-
-/**************************************************************************************************/
-
-void indent(std::size_t amount, std::ofstream& out) {
-    // REVISIT: Improve performance here.
-    for (std::size_t i{0}; i < amount * 4; ++i) out << ' ';
-}
-
-/**************************************************************************************************/
-
-void print_xml(stlab::forest<xml_node> xml, std::ofstream& out) {
-    stlab::depth_fullorder_iterator first{xml.begin()};
-    stlab::depth_fullorder_iterator last{xml.end()};
-
-    while (first != last) {
-        auto depth{first.depth()};
-        auto has_content{!first->_content.empty()};
-        if (is_leading(first)) {
-            indent(depth, out);
-
-            out << "<" << first->_tag;
-
-            for (const auto& a : first->_attributes) {
-                out << " " << a.first << "='" << a.second << "'";
-            }
-
-            if (stlab::has_children(first) || has_content) {
-                out << ">\n";
-            } else {
-                out << "/>\n";
-            }
-
-            if (has_content) {
-                out << first->_content << '\n';
-            }
-        } else if (stlab::has_children(first) || has_content) {
-            indent(depth, out);
-
-            out << "</" << first->_tag << ">\n";
-        }
-        ++first;
-    }
-}
-
-/**************************************************************************************************/
-// REVISIT: This should be the two-range variant of std::transform, though this one is inline so
-// is more performant.
-template <typename ForestIterator1, typename ForestIterator2, typename F>
-void apply_forest(ForestIterator1 dst_first,
-                  ForestIterator1 dst_last,
-                  ForestIterator2 src_first,
-                  F f) {
-    while (dst_first != dst_last) {
-        f(*dst_first, *src_first);
-        ++src_first;
-        ++dst_first;
-    }
-}
-
-/**************************************************************************************************/
-
-auto svg_bezier(const cubic_bezier& b) {
-    return "M " + std::to_string(b._s.x) + " " + std::to_string(b._s.y) +
-           " C" + std::to_string(b._c1.x) + " " + std::to_string(b._c1.y) +
-           " "  + std::to_string(b._c2.x) + " " + std::to_string(b._c2.y) +
-           " "  + std::to_string(b._e.x) + " " + std::to_string(b._e.y);
-}
-
-/**************************************************************************************************/
 
 //static const point n_k{std::cos(6*M_PI_4), std::sin(6*M_PI_4)};
 static const point nne_k{std::cos(6.5*M_PI_4), std::sin(6.5*M_PI_4)};
@@ -425,25 +191,126 @@ auto merge(edge_properties a, const edge_properties& b) {
 
 /**************************************************************************************************/
 
-auto derive_edge_properties(const std::string& edge_name, const edge_map& map, bool leading) {
-    const auto pfound{map.find(edge_name)};
-    edge_properties result{pfound != map.end() ? pfound->second : edge_properties()};
+// An edge's properties are its own, laid over those given for all leading or trailing edges.
+class edge_styles {
+public:
+    edge_styles(const edge_map& map, const name_table& names) :
+        _map{map}, _leading{names.find("_leading")}, _trailing{names.find("_trailing")} {}
 
-    const auto& edge_properties_name{leading ? "_leading" : "_trailing"};
+    edge_properties operator()(name_id edge_name, bool leading) const {
+        const auto& result{_map[edge_name]};
+        const auto base{leading ? _leading : _trailing};
 
-    const auto efound{map.find(edge_properties_name)};
-    if (efound != map.end()) {
-        result = merge(efound->second, result);
+        return base != name_table::empty_k ? merge(_map[base], result) : result;
     }
 
-    return result;
+    bool hidden(bool leading) const {
+        const auto base{leading ? _leading : _trailing};
+
+        return base != name_table::empty_k && _map[base]._hide;
+    }
+
+private:
+    const edge_map& _map;
+    name_id _leading;
+    name_id _trailing;
+};
+
+/**************************************************************************************************/
+
+// One end of an edge: the node's anchor point, and which of the node's edges the walk is on.
+struct edge_end {
+    point _p;
+    bool _leading;
+    bool _rect;
+};
+
+auto end_of(const svg::node& node, bool leading) {
+    const auto* circle{std::get_if<svg::circle>(&node)};
+    const auto* square{std::get_if<svg::square>(&node)};
+
+    assert(circle != nullptr || square != nullptr);
+
+    return square ? edge_end{square->_p, leading, true} : edge_end{circle->_c, leading, false};
 }
 
 /**************************************************************************************************/
+// The path from one edge of the fullorder walk to the next. Empty if that kind of edge is off.
+cubic_bezier route_edge(const edge_end& prev,
+                        const edge_end& cur,
+                        bool leaf_edges,
+                        bool leading_edges,
+                        bool trailing_edges) {
+    // min/max edge length delerp values
+    constexpr double min_mag_k{node_size_k + node_spacing_k};
+    constexpr double max_mag_k{min_mag_k * 2};
 
-auto derive_edges(const stlab::forest<svg::node>& f,
+    const auto t{delerp<double>((prev._p - cur._p).magnitude(), min_mag_k, max_mag_k)};
+
+    if (prev._leading) {
+        if (cur._leading && leading_edges) {
+            return edge_to_child(prev._p, cur._p, t, prev._rect);
+        } else if (leaf_edges) {
+            return edge_to_self(prev._p, cur._p, prev._rect);
+        }
+    } else {
+        if (cur._leading && leading_edges) {
+            return edge_to_sibling(prev._p, cur._p, t);
+        } else if (trailing_edges){
+            return edge_to_parent(prev._p, cur._p, t, cur._rect);
+        }
+    }
+
+    return cubic_bezier{};
+}
+
+/**************************************************************************************************/
+// Appends the drawn edge (the trimmed path, then its arrowhead) to `result`, if it is drawn.
+void add_edge(svg::nodes& result,
+              cubic_bezier bezier,
+              const edge_properties& properties,
+              bool cur_leading,
+              name_id label,
+              double arc_tolerance) {
+    if (bezier == cubic_bezier{} || properties._hide) return;
+
+    // get the arrowhead normal pre-trim, so it for sure points at the node.
+    const auto arrowhead_normal{bezier.derivative(1).unit()};
+
+    // Trim back the bezier path to account for the arrow. The label goes halfway along
+    // the untrimmed edge; find both from the one arc-length table and carry the label's
+    // spot over to the trimmed curve (whose t runs over [0, trim] of this one).
+    const alp arcs{bezier, arc_tolerance};
+    const auto trim{arcs.rfind(arrowhead_length_k)};
+    const auto label_t{trim > 0 ? std::min(arcs.find(arcs.length() / 2) / trim, 1.) : 0};
+
+    bezier = bezier.subdivide(trim).first;
+
+    result.push_back(svg::cubic_path{bezier,
+                                     properties._color,
+                                     stroke_width_k,
+                                     properties._stroke_dasharray,
+                                     cur_leading,
+                                     label,
+                                     label_t});
+
+    result.push_back(svg::arrowhead{bezier._e,
+                                    arrowhead_normal,
+                                    properties._color});
+
+#if 0
+    // Print the control points of the curve. Save these for debugging.
+    result.push_back(svg::line{bezier._s, bezier._c1, "green", 0.5});
+    result.push_back(svg::line{bezier._e, bezier._c2, "green", 0.5});
+#endif
+}
+
+/**************************************************************************************************/
+
+auto derive_edges(const flat_forest<svg::node>& f,
                   const edge_labels& labels,
-                  const edge_map& map,
+                  const edge_styles& styles,
+                  double arc_tolerance,
                   bool leaf_edges,
                   bool leading_edges,
                   bool trailing_edges,
@@ -485,75 +352,25 @@ auto derive_edges(const stlab::forest<svg::node>& f,
     auto  last{f.end()};
     auto  label_first{labels.begin()};
     auto  label_last{labels.end()};
-    bool  prev_leading{stlab::is_leading(first)};
-    const auto* prev_circle{std::get_if<svg::circle>(&*first)};
-    const auto* prev_square{std::get_if<svg::square>(&*first)};
-
-    assert(prev_circle != nullptr || prev_square != nullptr);
-
-    bool  prev_rect{prev_square != nullptr};
-    point prev{prev_rect ? prev_square->_p : prev_circle->_c};
-
-    auto add_edge{[&_result = result](cubic_bezier bezier,
-                                      const edge_properties& properties,
-                                      bool cur_leading,
-                                      std::string label) mutable {
-        if (bezier == cubic_bezier{} || properties._hide) return;
-
-        // get the arrowhead normal pre-trim, so it for sure points at the node.
-        const auto arrowhead_normal{bezier.derivative(1).unit()};
-
-        // trim back the bezier path to account for the arrow.
-        bezier = bezier.subdivide(alp(bezier).rfind(12)).first;
-
-        _result.push_back(svg::cubic_path{bezier,
-                                          properties._color,
-                                          stroke_width_k,
-                                          properties._stroke_dasharray,
-                                          cur_leading,
-                                          std::move(label)});
-
-        _result.push_back(svg::arrowhead{bezier._e,
-                                         arrowhead_normal,
-                                         properties._color});
-
-#if 0
-        // Print the control points of the curve. Save these for debugging.
-        _result.push_back(svg::line{bezier._s, bezier._c1, "green", 0.5});
-        _result.push_back(svg::line{bezier._e, bezier._c2, "green", 0.5});
-#endif
-    }};
+    auto  prev{end_of(*first, stlab::is_leading(first))};
 
     ++first;
 
-    // min/max edge length delerp values
-    constexpr double min_mag_k{node_size_k + node_spacing_k};
-    constexpr double max_mag_k{min_mag_k * 2};
-
     while (first != last) {
-        const bool  cur_leading{stlab::is_leading(first)};
-        const auto* cur_circle{std::get_if<svg::circle>(&*first)};
-        const auto* cur_square{std::get_if<svg::square>(&*first)};
-        auto label{label_first != label_last ? *label_first : ""};
-        edge_properties properties{derive_edge_properties(label, map, cur_leading)};
-
-        assert(cur_circle != nullptr || cur_square != nullptr);
-
-        bool  cur_rect{cur_square != nullptr};
-        point cur{cur_rect ? cur_square->_p : cur_circle->_c};
-        const auto cur_mag{(prev - cur).magnitude()};
-        const auto t{delerp<double>(cur_mag, min_mag_k, max_mag_k)};
-        cubic_bezier bezier;
+        const auto cur{end_of(*first, stlab::is_leading(first))};
+        const auto label{label_first != label_last ? *label_first : name_table::empty_k};
 
         if (with_root_top) {
             // A special case for the root top loop. Do not advance `first` so it'll
             // get properly reused. However, we do advance the label iterator because
             // we used a label for this loop.
 
-            add_edge(edge_to_self_top(prev),
-                     derive_edge_properties(label, map, true),
+            add_edge(result,
+                     edge_to_self_top(prev._p),
+                     styles(label, true),
                      true,
-                     label);
+                     label,
+                     arc_tolerance);
 
             if (label_first != label_last) {
                 ++label_first;
@@ -563,25 +380,13 @@ auto derive_edges(const stlab::forest<svg::node>& f,
             continue;
         }
 
+        add_edge(result,
+                 route_edge(prev, cur, leaf_edges, leading_edges, trailing_edges),
+                 styles(label, cur._leading),
+                 cur._leading,
+                 label,
+                 arc_tolerance);
 
-        if (prev_leading) {
-            if (cur_leading && leading_edges) {
-                bezier = edge_to_child(prev, cur, t, prev_rect);
-            } else if (leaf_edges) {
-                bezier = edge_to_self(prev, cur, prev_rect);
-            }
-        } else {
-            if (cur_leading && leading_edges) {
-                bezier = edge_to_sibling(prev, cur, t);
-            } else if (trailing_edges){
-                bezier = edge_to_parent(prev, cur, t, cur_rect);
-            }
-        }
-
-        add_edge(bezier, properties, cur_leading, label);
-
-        prev_rect = cur_rect;
-        prev_leading = cur_leading;
         prev = cur;
 
         ++first;
@@ -608,359 +413,690 @@ auto subscript_split(const std::string& s) {
 }
 
 /**************************************************************************************************/
+// Appends the label of the edge drawn by `path`, if it has one, to `result`.
+void add_edge_label(svg::nodes& result,
+                    const edge_styles& styles,
+                    const name_table& names,
+                    const svg::cubic_path& path) {
+    const auto& curve{path._b};
+    const auto& id{path._id};
+
+    if (id == name_table::empty_k) {
+        return;
+    }
 
-auto derive_edge_labels(const edge_map& map, const svg::nodes& edges) {
-    svg::nodes result;
+    auto properties{styles(id, path._leading)};
 
-    for (auto& edge : edges) {
-        const auto* curve_ptr{std::get_if<svg::cubic_path>(&edge)};
-        if (!curve_ptr) continue;
+    assert(curve != cubic_bezier{});
 
-        const auto& curve{curve_ptr->_b};
-        const auto& id{curve_ptr->_id};
+    // If the edge should have been hidden, it won't even be in the edges set.
+    assert(!properties._hide);
 
-        if (id.empty()) {
-            continue;
-        }
+    // The goal is to put the label along the edge. To do that we have to compute
+    // a point along the curve where we want to put the label, then an offset from
+    // that point where we want the label to go (lest the label be directly over
+    // the edge.) To get the offset, we take the derivative of the bezier at the
+    // same point, and compute its slope. Inverting that slope gives us a line
+    // that's perpendicular to the curve at the point we care about, and the label
+    // can "slide" up and down that line to figure out where we want it to go. For
+    // curves that are more or less flat at the point where we want the label (for
+    // some definition of "more or less flat"), we take an alternative path that
+    // does not rely on the slope of the perpendicular.
 
-        auto properties{derive_edge_properties(id, map, curve_ptr->_leading)};
-
-        assert(curve != cubic_bezier{});
-
-        // If the edge should have been hidden, it won't even be in the edges set.
-        assert(!properties._hide);
-
-        // The goal is to put the label along the edge. To do that we have to compute
-        // a point along the curve where we want to put the label, then an offset from
-        // that point where we want the label to go (lest the label be directly over
-        // the edge.) To get the offset, we take the derivative of the bezier at the
-        // same point, and compute its slope. Inverting that slope gives us a line
-        // that's perpendicular to the curve at the point we care about, and the label
-        // can "slide" up and down that line to figure out where we want it to go. For
-        // curves that are more or less flat at the point where we want the label (for
-        // some definition of "more or less flat"), we take an alternative path that
-        // does not rely on the slope of the perpendicular.
-
-        const alp arcs{curve};
-        const auto mid_distance{(arcs.length() + 12) / 2}; // 12 should be the same as when the edge was clipped.
-        const auto midpoint_t{arcs.find(mid_distance)};
-        const point mid{curve(midpoint_t)};
-        const point dmid{curve.derivative(midpoint_t)};
-        const double slope{dmid.x ? dmid.y / dmid.x : 0};
-        const bool flat{std::abs(slope) < 0.06};
-        const auto distance_k{font_size_k * properties._label_offset};
-
-        point tp;
-
-        if (flat) {
-            tp = mid;
-            tp.y -= distance_k;
-        } else {
-            const point pmid{point{-dmid.y, dmid.x}.unit()};
+    const auto midpoint_t{path._label_t};
+    const point mid{curve(midpoint_t)};
+    const point dmid{curve.derivative(midpoint_t)};
+    const double slope{dmid.x ? dmid.y / dmid.x : 0};
+    const bool flat{std::abs(slope) < 0.06};
+    const auto distance_k{font_size_k * properties._label_offset};
+
+    point tp;
+
+    if (flat) {
+        tp = mid;
+        tp.y -= distance_k;
+    } else {
+        const point pmid{point{-dmid.y, dmid.x}.unit()};
 
 #if 0
-            // Output the tangent at its magnitude. Save for debugging.
-            result.push_back(svg::line{mid, mid + dmid, "blue", 0.5});
+        // Output the tangent at its magnitude. Save for debugging.
+        result.push_back(svg::line{mid, mid + dmid, "blue", 0.5});
 #endif
 #if 0
-            // Output the unit normal for this point (slightly embiggened). Save for debugging.
-            result.push_back(svg::line{mid, mid + pmid * 5, "blue", 0.5});
+        // Output the unit normal for this point (slightly embiggened). Save for debugging.
+        result.push_back(svg::line{mid, mid + pmid * 5, "blue", 0.5});
 #endif
 
-            tp = mid + pmid * distance_k;
-        }
+        tp = mid + pmid * distance_k;
+    }
 
 #if 0
-        // Output the point from which the label is rendered. Save this for debugging.
-        result.push_back(svg::circle{tp - 0.25, 0.5, "blue", 1});
+    // Output the point from which the label is rendered. Save this for debugging.
+    result.push_back(svg::circle{tp - 0.25, 0.5, "blue", 1});
 #endif
 
-        auto split{subscript_split(id)};
+    auto split{subscript_split(names[id])};
+
+    result.push_back(svg::text{
+        tp,
+        std::move(split.first),
+        std::move(split.second),
+        font_size_k,
+        properties._color,
+        properties._text_anchor,
+    });
+}
 
-        result.push_back(svg::text{
-            tp,
-            std::move(split.first),
-            std::move(split.second),
-            font_size_k,
-            properties._color,
-            properties._text_anchor,
-        });
+/**************************************************************************************************/
+
+auto derive_edge_labels(const edge_styles& styles,
+                        const name_table& names,
+                        const svg::nodes& edges) {
+    svg::nodes result;
+
+    for (const auto& edge : edges) {
+        if (const auto* path = std::get_if<svg::cubic_path>(&edge)) {
+            add_edge_label(result, styles, names, *path);
+        }
     }
 
     return result;
 }
 
 /**************************************************************************************************/
+// The node's shape, at the origin until `place_node` moves it.
+svg::node node_shape(const node_map& map, name_id root_name, name_id n) {
+    const auto& node_properties{map[n]};
+    return n == root_name ?
+        svg::node{svg::square{
+            point{},
+            node_size_k,
+            "darkred",
+            stroke_width_k
+        }} :
+        svg::node{svg::circle{
+            point{},
+            node_radius_k,
+            node_properties._color,
+            stroke_width_k,
+            node_properties._stroke_dasharray
+        }};
+}
 
-xml_node svg_to_xml(svg::line line) {
-    return xml_node{
-        "line",
-        {
-            { "x1", std::to_string(line._a.x) },
-            { "y1", std::to_string(line._a.y) },
-            { "x2", std::to_string(line._b.x) },
-            { "y2", std::to_string(line._b.y) },
-            { "stroke", std::move(line._color) },
-            { "stroke-width", std::to_string(line._width) },
-        }
+// `p` is the top-left corner of the node's `node_size_k` square, as in `layout`.
+void place_node(svg::node& node, const point& p) {
+    if (auto* circle = std::get_if<svg::circle>(&node)) {
+        circle->_c = p + node_radius_k;
+    } else if (auto* square = std::get_if<svg::square>(&node)) {
+        square->_p = p;
+    } else {
+        throw std::runtime_error("Unknown node shape");
+    }
+}
+
+/**************************************************************************************************/
+// The node's label, also at the origin; it goes at the center of the node's square.
+svg::text node_label(const name_table& names, name_id n) {
+    auto split{subscript_split(names[n])};
+    return svg::text{
+        point{},
+        std::move(split.first),
+        std::move(split.second),
+        font_size_k,
+        "black",
+        "middle"
     };
 }
 
 /**************************************************************************************************/
 
-xml_node svg_to_xml(svg::cubic_path path) {
-    return xml_node{
-        "path",
-        {
-            { "d", svg_bezier(path._b) },
-            { "stroke", std::move(path._color) },
-            { "stroke-linecap", "round" },
-            { "fill", "none" },
-            { "stroke-width", std::to_string(path._width) },
-            { "stroke-dasharray", std::move(path._stroke_dasharray) },
-        }
-    };
+std::string render_svg(state state, const write_options& options) {
+    // Interned either way: a node the input itself names this is drawn as the root, too.
+    const auto root_name{state._names.intern(root_name_k)};
+
+    // Add optional root
+    if (state._s._with_root) {
+        auto first{stlab::child_begin(state._f.root())};
+        auto last{stlab::child_end(state._f.root())};
+        state._f.insert_parent(first, last, root_name);
+    }
+
+    // Save for debugging.
+    // fvg::print(state._f);
+
+    const auto layout{derive_layout(state._f, state._s)};
+    const auto width{layout._width};
+    const auto height{layout._height};
+
+    // All the passes below are read-only with respect to the shape of the forest, so walk a
+    // contiguous copy of it instead of the linked nodes.
+    const auto f{freeze(std::move(state._f))};
+
+    // Construct the nodes.
+
+    auto svg_nodes{transcribe_forest(f, [&_map = std::as_const(state._n), root_name](name_id n){
+        return node_shape(_map, root_name, n);
+    })};
+
+    // Both the node values and the layout are in preorder.
+    for (std::size_t i{0}, n{svg_nodes.size()}; i < n; ++i) {
+        place_node(svg_nodes.values()[i], point{layout._x[i], layout._y[i]});
+    }
+
+    // Derive the edges.
+
+    const edge_styles styles{state._e, state._names};
+
+    auto svg_edges{derive_edges(svg_nodes,
+                                state._l,
+                                styles,
+                                options._arc_tolerance,
+                                state._s._with_leaf_edges,
+                                !styles.hidden(true),
+                                !styles.hidden(false),
+                                state._s._with_root && state._s._with_root_top)};
+
+    // Construct the node labels.
+
+    auto svg_labels{transcribe_forest(f, [&_names = std::as_const(state._names)](name_id n){
+        return node_label(_names, n);
+    })};
+
+    for (std::size_t i{0}, n{svg_labels.size()}; i < n; ++i) {
+        svg_labels.values()[i]._p = point{layout._x[i], layout._y[i]} + node_radius_k;
+    }
+
+    // Construct edge labels
+
+    auto edge_labels{derive_edge_labels(styles, state._names, svg_edges)};
+
+    // Serialize everything in one pass, straight into the output buffer.
+
+    std::string buffer;
+    svg::writer writer{buffer, options._svg};
+
+    writer.begin(width, height);
+
+    for (const auto& edge : svg_edges) {
+        writer.write(edge);
+    }
+
+    for (const auto& label : edge_labels) {
+        writer.write(label);
+    }
+
+    for (const auto& node : svg_nodes.values()) {
+        writer.write(node);
+    }
+
+    for (const auto& label : svg_labels.values()) {
+        writer.write(label);
+    }
+
+    writer.end();
+
+    return buffer;
 }
 
 /**************************************************************************************************/
 
-xml_node svg_to_xml(svg::text text) {
-    const auto drop{std::to_string(text._size / 2)};
+void write_document(const std::filesystem::path& path,
+                    std::string_view document,
+                    const write_options& options) {
+    if (options._gzip || path.extension() == svgz_extension_k) {
+        write_gzip_output(path, document, options._gzip_level);
+    } else {
+        write_output(path, document);
+    }
+}
 
-    const auto string{std::move(text._s) +
-           "<tspan dy=\'" + drop + "\' font-size=\'.7em\'>" +
-           std::move(text._subscript) +
-           "</tspan>"
-    };
+/**************************************************************************************************/
 
-    return xml_node{
-        "text",
-        {
-            { "font-size", std::to_string(text._size) },
-            { "text-anchor", std::move(text._text_anchor) },
-            { "dominant-baseline", "central" },
-            { "x", std::to_string(text._p.x) },
-            { "y", std::to_string(text._p.y) },
-            { "fill", std::move(text._color) }
-        },
-        std::move(string)
-    };
+void write_svg(state state, const std::filesystem::path& path, const write_options& options) {
+    write_document(path, render_svg(std::move(state), options), options);
 }
 
 /**************************************************************************************************/
 
-xml_node svg_to_xml(svg::circle c) {
-    return xml_node{
-        "circle",
-        {
-            { "cx", std::to_string(c._c.x) },
-            { "cy", std::to_string(c._c.y) },
-            { "r", std::to_string(c._r) },
-            { "fill", "white" },
-            { "stroke", std::move(c._color) },
-            { "stroke-width", std::to_string(c._stroke_width) },
-            { "stroke-dasharray", std::move(c._stroke_dasharray) },
+live_layout::live_layout(state state, const write_options& options) :
+    _state{std::move(state)}, _options{options}, _root_name{_state._names.intern(root_name_k)} {
+    auto& f{_state._f};
+
+    if (_state._s._with_root) {
+        f.insert_parent(stlab::child_begin(f.root()), stlab::child_end(f.root()), _root_name);
+    }
+
+    // Copy the forest over, deriving widths on the way back up as `derive_layout` does. Nodes
+    // are only ever appended, so past the trailing edge of one is its parent's (or the end.)
+    auto p{_f.end()};
+    std::size_t depth{0};
+
+    for (auto first{f.begin()}, last{f.end()}; first != last; ++first) {
+        if (stlab::is_leading(first)) {
+            const auto inserted{_f.insert(p, make_node(*first, depth++))};
+            index(inserted);
+            p = stlab::trailing_of(inserted);
+        } else {
+            p->_width = p->_children_width ? p->_children_width - node_spacing_k : node_size_k;
+
+            const auto parent{std::next(p)};
+            auto& children_width{parent == _f.end() ? _top_width : parent->_children_width};
+
+            children_width += p->_width + node_spacing_k;
+            p = parent;
+            --depth;
         }
-    };
+    }
+
+    f.clear();
+
+    refresh(_f.begin(), {});
 }
 
 /**************************************************************************************************/
 
-xml_node svg_to_xml(svg::square s) {
-    return xml_node{
-        "rect",
-        {
-            { "x", std::to_string(s._p.x) },
-            { "y", std::to_string(s._p.y) },
-            { "width", std::to_string(s._size) },
-            { "height", std::to_string(s._size) },
-            { "fill", "white" },
-            { "stroke", std::move(s._color) },
-            { "stroke-width", std::to_string(s._stroke_width) },
+auto live_layout::insert(const iterator& position, std::string_view name) -> iterator {
+    const auto parent{parent_of(position)};
+    const auto depth{parent == _f.end() ? 0 : parent->_depth + 1};
+    const auto result{_f.insert(position, make_node(_state._names.intern(name), depth))};
+    index(result);
+    const auto next{std::next(stlab::trailing_of(result))};
+
+    if (next != _f.end()) {
+        slot(next)._dirty = true;
+    }
+
+    std::vector<iterator> moved;
+    resize(parent, node_size_k + node_spacing_k, moved);
+    refresh(result, moved);
+
+    return result;
+}
+
+/**************************************************************************************************/
+
+auto live_layout::erase(const iterator& position) -> iterator {
+    const auto first{stlab::leading_of(position)};
+    const auto last{std::next(stlab::trailing_of(position))};
+    const auto parent{stlab::find_parent(first)};
+    const auto width{first->_width};
+
+    for (auto i{first}; i != last; ++i) {
+        if (stlab::is_leading(i)) {
+            --_tiers[i->_depth];
+            unindex(i);
         }
-    };
+    }
+
+    while (!_tiers.empty() && !_tiers.back()) {
+        _tiers.pop_back();
+    }
+
+    _f.erase(first, last);
+
+    if (last != _f.end()) {
+        slot(last)._dirty = true;
+    }
+
+    std::vector<iterator> moved;
+    resize(parent, -static_cast<std::ptrdiff_t>(width + node_spacing_k), moved);
+    refresh(last, moved);
+
+    return last;
 }
 
 /**************************************************************************************************/
 
-xml_node svg_to_xml(svg::arrowhead a) {
-    const point perp{-a._n.y, a._n.x};
-    const point p0{a._p - perp * 5};
-    const point p1{a._p + a._n * 12};
-    const point p2{a._p + perp * 5};
+void live_layout::rename(const iterator& position, std::string_view name) {
+    const auto leading{stlab::leading_of(position)};
+    const auto trailing{stlab::trailing_of(position)};
 
-    static const auto p2s{[](const point& p){
-        return std::to_string(p.x) + " " + std::to_string(p.y);
-    }};
+    unindex(leading);
+    leading->_name = _state._names.intern(name);
+    index(leading);
+    reshape(*leading);
 
-    return xml_node{
-        "polygon",
-        {
-            { "points", p2s(p0) + ", " + p2s(p1) + ", " +p2s(p2) },
-            { "fill", std::move(a._color) },
-            { "stroke", "none" },
-        }
-    };
+    // The node may have turned into (or out of) the root, which edges meet differently.
+    std::vector<iterator> also{leading, std::next(leading), trailing};
+
+    if (std::next(trailing) != _f.end()) {
+        also.push_back(std::next(trailing));
+    }
+
+    for (const auto& i : also) {
+        slot(i)._dirty = true;
+    }
+
+    refresh(_f.end(), also);
 }
 
 /**************************************************************************************************/
 
-xml_node svg_to_xml(svg::node n) {
-    return std::visit([](auto&& n) {
-        // We call the function this way to detect at compile time if there
-        // is a version of the API we want to call for the _specific_ type.
-        // Don't let the compiler shoot us in the foot here by taking us to
-        // some routine it thinks we want (including wrapping back around
-        // into this one implicitly.)
-        xml_node(*f)(std::decay_t<decltype(n)>){&svg_to_xml};
-        return f(std::forward<decltype(n)>(n));
-    }, std::move(n));
+void live_layout::restyle(const iterator& position, node_properties properties) {
+    const auto name{position->_name};
+
+    _state._n[name] = std::move(properties);
+
+    // Edges don't depend on node properties; only the shapes change.
+    for (const auto& i : _named[name]) {
+        reshape(*i);
+    }
 }
 
 /**************************************************************************************************/
 
-void write_svg(state state, const std::filesystem::path& path) {
-    std::ofstream out{path, std::ios::out | std::ios::binary};
+double live_layout::width() const {
+    const auto& settings{_state._s};
 
-    if (!out) {
-        throw std::runtime_error("error creating output file");
+    if (settings._layout == layout_style::tidy) {
+        return _tidy_width + settings._margin.width();
     }
 
-    // Add optional root
-    if (state._s._with_root) {
-        auto first{stlab::child_begin(state._f.root())};
-        auto last{stlab::child_end(state._f.root())};
-        state._f.insert_parent(first, last, root_name_k);
+    return (_top_width ? _top_width - node_spacing_k : 0) + settings._margin.width();
+}
+
+/**************************************************************************************************/
+
+double live_layout::height() const {
+    const auto max_depth{_tiers.empty() ? 0 : _tiers.size() - 1};
+
+    // As in `derive_layout`.
+    auto height{(tier_height_k + node_spacing_k) * (max_depth + 1)};
+
+    if (!_state._s._with_leaf_edges) {
+        height -= node_spacing_k;
     }
 
-    auto counts = child_counts(state);
-    auto widths = derive_widths(counts);
-    auto height = derive_height(counts, state._s._with_leaf_edges, state._s._margin.height());
-    auto width = derive_width(widths, state._s._margin.width());
-    auto x_offsets = derive_x_offsets(widths, state._s._margin.l);
-    auto y_offsets = derive_y_offsets(state, state._s._margin.t);
+    return height + _state._s._margin.height();
+}
 
-    // Save for debugging.
-    // fvg::print(state._f);
-    // std::cout << "=-=-=-=-\n";
-    // fvg::print(counts);
-    // std::cout << "=-=-=-=-\n";
-    // fvg::print(widths);
-    // std::cout << "=-=-=-=-\n";
-    // fvg::print(x_offsets);
-    // std::cout << "=-=-=-=-\n";
-    // fvg::print(y_offsets);
+/**************************************************************************************************/
 
-    // Construct the nodes.
+void live_layout::write(std::string& out) const {
+    svg::writer writer{out, _options._svg};
 
-    auto svg_nodes{transcribe_forest(state._f, [&_map = state._n](const auto& n){
-        const auto& node_properties{_map[n]};
-        return n == root_name_k ?
-            svg::node{svg::square{
-                point{},
-                node_size_k,
-                "darkred",
-                stroke_width_k
-            }} :
-            svg::node{svg::circle{
-                point{},
-                node_radius_k,
-                node_properties._color,
-                stroke_width_k,
-                node_properties._stroke_dasharray
-            }};
-    })};
+    writer.begin(width(), height());
 
-    apply_forest(svg_nodes.begin(), svg_nodes.end(), x_offsets.begin(), [](auto& a, auto& b){
-        if (auto* circle = std::get_if<svg::circle>(&a)) {
-            circle->_c.x = b + node_radius_k;
-        } else if (auto* square = std::get_if<svg::square>(&a)) {
-            square->_p.x = b;
-        } else {
-            throw std::runtime_error("Unknown node shape");
+    for (const auto& edge : _top_loop) {
+        writer.write(edge);
+    }
+
+    for (auto first{_f.begin()}, last{_f.end()}; first != last; ++first) {
+        for (const auto& edge : slot(first)._edge) {
+            writer.write(edge);
         }
-    });
+    }
 
-    apply_forest(svg_nodes.begin(), svg_nodes.end(), y_offsets.begin(), [](auto& a, auto& b){
-        if (auto* circle = std::get_if<svg::circle>(&a)) {
-            circle->_c.y = b + node_radius_k;
-        } else if (auto* square = std::get_if<svg::square>(&a)) {
-            square->_p.y = b;
-        } else {
-            throw std::runtime_error("Unknown node shape");
+    for (const auto& label : _top_loop_label) {
+        writer.write(label);
+    }
+
+    for (auto first{_f.begin()}, last{_f.end()}; first != last; ++first) {
+        for (const auto& label : slot(first)._edge_label) {
+            writer.write(label);
         }
-    });
+    }
 
-    // Derive the edges.
+    for (auto first{_f.begin()}, last{_f.end()}; first != last; ++first) {
+        if (stlab::is_leading(first)) writer.write(first->_shape);
+    }
 
-    auto svg_edges{derive_edges(svg_nodes,
-                                state._l,
-                                state._e,
-                                state._s._with_leaf_edges,
-                                !state._e["_leading"]._hide,
-                                !state._e["_trailing"]._hide,
-                                state._s._with_root && state._s._with_root_top)};
+    for (auto first{_f.begin()}, last{_f.end()}; first != last; ++first) {
+        if (stlab::is_leading(first)) writer.write(first->_label);
+    }
 
-    // Construct the node labels.
+    writer.end();
+}
 
-    auto svg_labels{transcribe_forest(state._f, [](const auto& n){
-        auto split{subscript_split(n)};
-        return svg::text{
-            point{},
-            std::move(split.first),
-            std::move(split.second),
-            font_size_k,
-            "black",
-            "middle"
-        };
-    })};
+/**************************************************************************************************/
 
-    apply_forest(svg_labels.begin(), svg_labels.end(), x_offsets.begin(), [](auto& a, auto& b){
-        a._p.x = b + node_radius_k;
-    });
+auto live_layout::make_node(name_id name, std::size_t depth) -> node {
+    const std::size_t y(_state._s._margin.t + (tier_height_k + node_spacing_k) * depth);
+    node result;
 
-    apply_forest(svg_labels.begin(), svg_labels.end(), y_offsets.begin(), [](auto& a, auto& b){
-        a._p.y = b + node_radius_k;
-    });
+    result._name = name;
+    result._depth = depth;
+    result._width = node_size_k;
+    result._p = point{0, static_cast<double>(y)};
+    reshape(result);
 
-    // Construct edge labels
+    if (_tiers.size() <= depth) {
+        _tiers.resize(depth + 1);
+    }
 
-    auto edge_labels{derive_edge_labels(state._e, svg_edges)};
+    ++_tiers[depth];
 
-    // Begin constructing the final XML.
+    return result;
+}
+
+/**************************************************************************************************/
 
-    out << "<?xml version='1.0' encoding='utf-8'?>\n";
+void live_layout::index(const iterator& leading) {
+    _named[leading->_name].push_back(leading);
+}
+
+void live_layout::unindex(const iterator& leading) {
+    auto& named{_named[leading->_name]};
+    auto found{std::find(named.begin(), named.end(), leading)};
 
-    stlab::forest<xml_node> xml;
+    *found = named.back();
+    named.pop_back();
+}
 
-    // Trailing ensures the inserted elements are a child of the svg entry.
-    auto p = stlab::trailing_of(xml.insert(xml.begin(), xml_node{
-        "svg",
-        {
-            { "xmlns", "http://www.w3.org/2000/svg" },
-            { "xmlns:xlink", "http://www.w3.org/1999/xlink" },
-            { "width", std::to_string(width) },
-            { "height", std::to_string(height) },
+/**************************************************************************************************/
+
+void live_layout::reshape(node& n) {
+    n._shape = node_shape(_state._n, _root_name, n._name);
+    place_node(n._shape, n._p);
+    n._label = node_label(_state._names, n._name);
+    n._label._p = n._p + node_radius_k;
+}
+
+/**************************************************************************************************/
+// The trailing edge of the node a node inserted at `position` goes under; `end()` at the top.
+auto live_layout::parent_of(const iterator& position) -> iterator {
+    return stlab::is_trailing(position) ? position : stlab::find_parent(position);
+}
+
+/**************************************************************************************************/
+// Adds `delta` to the children's width of `parent`, then carries the change in its width on up
+// for as long as there is one. The nodes that moved are the ones whose width changed, since each
+// is centered over its width; `moved` collects the edges arriving at and leaving them.
+void live_layout::resize(iterator parent, std::ptrdiff_t delta, std::vector<iterator>& moved) {
+    while (delta) {
+        if (parent == _f.end()) {
+            _top_width += delta;
+            return;
         }
-    }));
 
-    for (auto& edge : svg_edges) {
-        xml.insert(p, svg_to_xml(std::move(edge)));
+        const auto width{parent->_width};
+
+        parent->_children_width += delta;
+        parent->_width = parent->_children_width ?
+                             parent->_children_width - node_spacing_k :
+                             node_size_k;
+
+        delta = static_cast<std::ptrdiff_t>(parent->_width) - static_cast<std::ptrdiff_t>(width);
+
+        if (delta) {
+            const auto leading{stlab::leading_of(parent)};
+            moved.push_back(leading);
+            moved.push_back(std::next(leading));
+        }
+
+        parent = stlab::find_parent(parent);
+    }
+}
+
+/**************************************************************************************************/
+// Lays out x from `first` to the end of the forest, then brings the edges arriving there, and
+// the ones at `also` (all before `first`), up to date.
+void live_layout::refresh(iterator first, const std::vector<iterator>& also) {
+    const auto& settings{_state._s};
+    const edge_styles styles{_state._e, _state._names};
+    const bool leading_edges{!styles.hidden(true)};
+    const bool trailing_edges{!styles.hidden(false)};
+    const bool root_top{settings._with_root && settings._with_root_top};
+
+    // x offsets: all of them for a tidy layout, otherwise the same arithmetic as `derive_layout`,
+    // picked up where the node before `first` left the cursor.
+
+    if (settings._layout == layout_style::tidy) {
+        first = _f.begin();
+        place_tidy();
+    } else {
+        std::size_t cursor(settings._margin.l);
+
+        if (const auto prev{std::prev(first)}; prev != _f.root()) {
+            cursor = stlab::is_leading(prev) ? prev->_left :
+                                               prev->_left + prev->_width + node_spacing_k;
+        }
+
+        for (auto i{first}; i != _f.end(); ++i) {
+            if (stlab::is_leading(i)) {
+                i->_left = cursor;
+                continue;
+            }
+
+            i->_p.x = static_cast<double>(i->_left + (i->_width - node_size_k) / 2);
+            place_node(i->_shape, i->_p);
+            i->_label._p = i->_p + node_radius_k;
+            cursor = i->_left + i->_width + node_spacing_k;
+        }
+    }
+
+    // Edges. One whose ends moved together (and still carries the same label) is translated,
+    // anything else about it changing means deriving it again.
+
+    const auto update{[&](const iterator& i) {
+        auto& slot{live_layout::slot(i)};
+        const auto prev{std::prev(i)};
+
+        if (prev == _f.root()) {
+            slot = edge_slot{0, name_table::empty_k, false, 0, 0, {}, {}};
+            return;
+        }
+
+        const auto index{live_layout::slot(prev)._index + 1};
+        const auto label{label_at(index - 1 + root_top)};
+        const auto dx{i->_p.x - slot._to_x};
+
+        slot._index = index;
+
+        if (!slot._dirty && slot._label == label && prev->_p.x - slot._from_x == dx) {
+            if (dx) {
+                for (auto& e : slot._edge) svg::translate(e, point{dx, 0});
+                for (auto& e : slot._edge_label) svg::translate(e, point{dx, 0});
+                slot._from_x = prev->_p.x;
+                slot._to_x = i->_p.x;
+            }
+            return;
+        }
+
+        const auto leading{stlab::is_leading(i)};
+
+        slot._label = label;
+        slot._dirty = false;
+        slot._from_x = prev->_p.x;
+        slot._to_x = i->_p.x;
+        slot._edge.clear();
+        slot._edge_label.clear();
+
+        add_edge(slot._edge,
+                 route_edge(end_of(prev->_shape, stlab::is_leading(prev)),
+                            end_of(i->_shape, leading),
+                            settings._with_leaf_edges,
+                            leading_edges,
+                            trailing_edges),
+                 styles(label, leading),
+                 leading,
+                 label,
+                 _options._arc_tolerance);
+
+        if (!slot._edge.empty()) {
+            add_edge_label(slot._edge_label,
+                           styles,
+                           _state._names,
+                           std::get<svg::cubic_path>(slot._edge.front()));
+        }
+    }};
+
+    for (const auto& i : also) {
+        update(i);
     }
 
-    for (auto& label : edge_labels) {
-        xml.insert(p, svg_to_xml(std::move(label)));
+    for (auto i{first}; i != _f.end(); ++i) {
+        update(i);
     }
 
-    for (auto& node : stlab::preorder_range(svg_nodes)) {
-        xml.insert(p, svg_to_xml(std::move(node)));
+    // The root's top loop takes the first edge label, ahead of every other edge. It is a single
+    // edge, so it is simply derived again.
+
+    _top_loop.clear();
+    _top_loop_label.clear();
+
+    if (root_top && !_f.empty()) {
+        const auto label{label_at(0)};
+
+        add_edge(_top_loop,
+                 edge_to_self_top(end_of(_f.begin()->_shape, true)._p),
+                 styles(label, true),
+                 true,
+                 label,
+                 _options._arc_tolerance);
+
+        if (!_top_loop.empty()) {
+            add_edge_label(_top_loop_label,
+                           styles,
+                           _state._names,
+                           std::get<svg::cubic_path>(_top_loop.front()));
+        }
     }
+}
 
-    for (auto& label : stlab::preorder_range(svg_labels)) {
-        xml.insert(p, svg_to_xml(std::move(label)));
+/**************************************************************************************************/
+
+void live_layout::place_tidy() {
+    std::vector<iterator> nodes;
+    std::vector<std::size_t> parents;
+    std::vector<std::size_t> open;
+
+    for (auto first{_f.begin()}, last{_f.end()}; first != last; ++first) {
+        if (stlab::is_leading(first)) {
+            parents.push_back(open.empty() ? top_level_k : open.back());
+            open.push_back(nodes.size());
+            nodes.push_back(first);
+        } else {
+            open.pop_back();
+        }
     }
 
-    print_xml(std::move(xml), out);
+    const auto offsets{tidy_offsets(parents)};
+
+    _tidy_width = 0;
+
+    for (std::size_t i{0}, n{nodes.size()}; i < n; ++i) {
+        auto& node{*nodes[i]};
+
+        node._p.x = offsets[i] + _state._s._margin.l;
+        place_node(node._shape, node._p);
+        node._label._p = node._p + node_radius_k;
+        _tidy_width = std::max(_tidy_width, offsets[i] + node_size_k);
+    }
+}
+
+/**************************************************************************************************/
+
+name_id live_layout::label_at(std::size_t index) const {
+    return index < _state._l.size() ? _state._l[index] : name_table::empty_k;
+}
+
+/**************************************************************************************************/
+
+void write_svg(const live_layout& layout, const std::filesystem::path& path) {
+    std::string buffer;
+    layout.write(buffer);
+    write_document(path, buffer, layout.options());
 }
 
 /**************************************************************************************************/
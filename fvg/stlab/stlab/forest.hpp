@@ -14,6 +14,7 @@
 #include <cstddef>
 #include <functional>
 #include <iterator>
+#include <memory>
 
 #include <stlab/algorithm/reverse.hpp>
 #include <stlab/iterator/set_next.hpp>
@@ -489,9 +490,14 @@ private:
 
 template <class Forest>
 class child_adaptor;
-template <class T>
+template <class T, class Allocator = std::allocator<T>, bool Counted = false>
 class forest;
 
+template <class I>
+child_iterator<I> child_begin(const I& x);
+template <class I>
+child_iterator<I> child_end(const I& x);
+
 /**************************************************************************************************/
 
 namespace detail {
@@ -525,12 +531,31 @@ struct node : public node_base<node<T>> {
     using value_type = T;
 
     explicit node(const value_type& data) : _data(data) {}
+    explicit node(value_type&& data) : _data(std::move(data)) {}
 
     value_type _data;
 };
 
 /**************************************************************************************************/
 
+template <class N> // N is node<T>
+struct node_counts {
+    N* _parent{nullptr};       // the forest's tail for top-level nodes; null for the tail itself
+    std::size_t _children{0};  // immediate children
+    std::size_t _weight{1};    // nodes in the subtree, this one included
+};
+
+// The links still point at node<T>, so iterators are the same in either mode. Only the forest,
+// which knows which kind of node it allocated, ever looks at the counts.
+template <class T>
+struct counted_node : public node<T> {
+    using node<T>::node;
+
+    node_counts<node<T>> _counts;
+};
+
+/**************************************************************************************************/
+
 template <class T>
 struct forest_const_iterator;
 
@@ -578,7 +603,8 @@ struct forest_iterator {
     friend bool operator!=(const forest_iterator& a, const forest_iterator& b) { return !(a == b); }
 
 private:
-    friend class stlab::forest<value_type>;
+    template <class, class, bool>
+    friend class stlab::forest;
     template <class>
     friend struct forest_iterator;
     template <class>
@@ -668,7 +694,7 @@ struct forest_const_iterator {
     }
 
 private:
-    template <class>
+    template <class, class, bool>
     friend class stlab::forest;
     template <class>
     friend struct forest_const_iterator;
@@ -736,11 +762,26 @@ struct set_next_fn<detail::forest_iterator<T>> {
 
 /**************************************************************************************************/
 
-template <class T>
+/*
+    The allocator is rebound to the node type and is used for every node the forest creates or
+    destroys. Its pointer type must be a raw pointer. Nodes may only be spliced between forests
+    whose allocators compare equal; moving a forest carries its allocator along with its nodes.
+
+    When `Counted` is true every node also records its parent, its number of children and the
+    size of its subtree. `size()`, `child_count()` and `subtree_size()` are then constant time,
+    and `size()` is never invalidated by a splice. The price is a walk up the ancestors on each
+    insert, erase and splice (O(depth), plus O(children) to re-parent them on erase or splice).
+*/
+template <class T, class Allocator, bool Counted>
 class forest {
 private:
     using node_t = detail::node<T>;
-    friend class child_adaptor<forest<T>>;
+    using stored_node_t = std::conditional_t<Counted, detail::counted_node<T>, node_t>;
+    using counts_t = detail::node_counts<node_t>;
+    using node_allocator_type =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<stored_node_t>;
+    using node_allocator_traits = std::allocator_traits<node_allocator_type>;
+    friend class child_adaptor<forest>;
 
 public:
     // types
@@ -751,6 +792,7 @@ public:
     using size_type = std::size_t;
     using difference_type = std::ptrdiff_t;
     using value_type = T;
+    using allocator_type = Allocator;
     using pointer = T*;
     using const_pointer = const T*;
     using reverse_iterator = reverse_fullorder_iterator<iterator>;
@@ -769,29 +811,39 @@ public:
     using const_postorder_iterator = edge_iterator<const_iterator, forest_edge::trailing>;
 
     forest() = default;
+    explicit forest(const allocator_type& a) : _alloc(a) {}
     ~forest() { clear(); }
 
-    forest(const forest& x) : forest() {
+    forest(const forest& x) :
+        _alloc(node_allocator_traits::select_on_container_copy_construction(x._alloc)) {
         insert(end(), const_child_iterator(x.begin()), const_child_iterator(x.end()));
     }
-    forest(forest&& x) noexcept : forest() { splice(end(), x); }
+    forest(forest&& x) noexcept : _alloc(x._alloc) { splice(end(), x); }
     forest& operator=(const forest& x) {
     return *this = forest(x);
     }
     forest& operator=(forest&& x) noexcept {
-        auto tmp{move(x)}; // this is `release()`
+        auto tmp{std::move(x)}; // this is `release()`
         clear(); // these two lines are `reset()`
+        _alloc = tmp._alloc; // the nodes we are about to take belong to this allocator
         splice(end(), tmp);
         return *this;
     }
 
+    allocator_type get_allocator() const { return allocator_type(_alloc); }
+
     void swap(forest& x) { std::swap(*this, x); }
 
     size_type size() const;
     size_type max_size() const { return size_type(-1); }
-    bool size_valid() const { return _size != 0 || empty(); }
+    bool size_valid() const { return Counted || _size != 0 || empty(); }
     bool empty() const { return begin() == end(); } // Don't test size which may be expensive
 
+    // Constant time when Counted, otherwise a walk over the children (or the whole subtree.)
+    // `subtree_size` counts the node itself; for `root()` it is the size of the forest.
+    size_type child_count(const const_iterator& i) const;
+    size_type subtree_size(const const_iterator& i) const;
+
     // iterators
     iterator root() { return iterator(tail(), forest_edge::leading); }
     const_iterator root() const { return const_iterator(tail(), forest_edge::leading); }
@@ -824,19 +876,23 @@ public:
     }
 
     // modifiers
-    void clear() {
-        erase(begin(), end());
-        assert(empty()); // Make sure our erase is correct
-    }
+    void clear();
 
     iterator erase(const iterator& position);
     iterator erase(const iterator& first, const iterator& last);
 
     iterator insert(const iterator& position, T x) {
-        iterator result(new node_t(std::move(x)), forest_edge::leading);
+        iterator result(create_node(std::move(x)), forest_edge::leading);
 
         if (size_valid()) ++_size;
 
+        if constexpr (Counted) {
+            node_t* parent(parent_at(position));
+            counts(result._node)._parent = parent;
+            ++counts(parent)._children;
+            add_weight(parent, 1);
+        }
+
         unsafe::set_next(std::prev(position), result);
         unsafe::set_next(std::next(result), position);
 
@@ -856,11 +912,11 @@ public:
 
     iterator insert(iterator position, const_child_iterator first, const_child_iterator last);
 
-    iterator splice(iterator position, forest<T>& x);
-    iterator splice(iterator position, forest<T>& x, iterator i);
-    iterator splice(iterator position, forest<T>& x, child_iterator first, child_iterator last);
+    iterator splice(iterator position, forest& x);
+    iterator splice(iterator position, forest& x, iterator i);
+    iterator splice(iterator position, forest& x, child_iterator first, child_iterator last);
     iterator splice(iterator position,
-                    forest<T>& x,
+                    forest& x,
                     child_iterator first,
                     child_iterator last,
                     size_type count);
@@ -875,15 +931,53 @@ private:
 
     mutable size_type _size{0};
     detail::node_base<node_t> _tail;
+    counts_t _tail_counts{nullptr, 0, 0}; // only maintained when Counted
+    node_allocator_type _alloc;
 
     node_t* tail() { return static_cast<node_t*>(&_tail); }
     const node_t* tail() const { return static_cast<const node_t*>(&_tail); }
+
+    node_t* create_node(T&& x) {
+        stored_node_t* result(node_allocator_traits::allocate(_alloc, 1));
+        try {
+            node_allocator_traits::construct(_alloc, result, std::move(x));
+        } catch (...) {
+            node_allocator_traits::deallocate(_alloc, result, 1);
+            throw;
+        }
+        return result;
+    }
+
+    void destroy_node(node_t* x) {
+        stored_node_t* node(static_cast<stored_node_t*>(x));
+        node_allocator_traits::destroy(_alloc, node);
+        node_allocator_traits::deallocate(_alloc, node, 1);
+    }
+
+    counts_t& counts(node_t* x) {
+        return x == tail() ? _tail_counts : static_cast<stored_node_t*>(x)->_counts;
+    }
+    const counts_t& counts(const node_t* x) const {
+        return x == tail() ? _tail_counts : static_cast<const stored_node_t*>(x)->_counts;
+    }
+
+    // The node that a node inserted at `position` would be a child of.
+    node_t* parent_at(const iterator& position) {
+        return is_leading(position) ? counts(position._node)._parent : position._node;
+    }
+
+    void add_weight(node_t* x, size_type n) {
+        for (; x; x = counts(x)._parent) counts(x)._weight += n;
+    }
+    void remove_weight(node_t* x, size_type n) {
+        for (; x; x = counts(x)._parent) counts(x)._weight -= n;
+    }
 };
 
 /**************************************************************************************************/
 
-template <class T>
-bool operator==(const forest<T>& x, const forest<T>& y) {
+template <class T, class A, bool C>
+bool operator==(const forest<T, A, C>& x, const forest<T, A, C>& y) {
     if (x.size() != y.size()) return false;
 
     for (auto first(x.begin()), last(x.end()), pos(y.begin()); first != last; ++first, ++pos) {
@@ -894,8 +988,8 @@ bool operator==(const forest<T>& x, const forest<T>& y) {
     return true;
 }
 
-template <class T>
-bool operator!=(const forest<T>& x, const forest<T>& y) {
+template <class T, class A, bool C>
+bool operator!=(const forest<T, A, C>& x, const forest<T, A, C>& y) {
     return !(x == y);
 }
 
@@ -918,8 +1012,10 @@ struct set_next_fn<child_iterator<I>> {
 
 /**************************************************************************************************/
 
-template <class T>
-typename forest<T>::size_type forest<T>::size() const {
+template <class T, class A, bool Counted>
+typename forest<T, A, Counted>::size_type forest<T, A, Counted>::size() const {
+    if constexpr (Counted) return _tail_counts._weight;
+
     if (!size_valid()) {
         const_preorder_iterator first(begin());
         const_preorder_iterator last(end());
@@ -932,8 +1028,64 @@ typename forest<T>::size_type forest<T>::size() const {
 
 /**************************************************************************************************/
 
-template <class T>
-typename forest<T>::iterator forest<T>::erase(const iterator& first, const iterator& last) {
+template <class T, class A, bool Counted>
+typename forest<T, A, Counted>::size_type forest<T, A, Counted>::child_count(
+    const const_iterator& i) const {
+    if constexpr (Counted) return counts(i._node)._children;
+
+    return size_type(std::distance(child_begin(i), child_end(i)));
+}
+
+/**************************************************************************************************/
+
+template <class T, class A, bool Counted>
+typename forest<T, A, Counted>::size_type forest<T, A, Counted>::subtree_size(
+    const const_iterator& i) const {
+    if constexpr (Counted) return counts(i._node)._weight;
+
+    if (i._node == tail()) return size();
+
+    const_preorder_iterator first(leading_of(i));
+    const_preorder_iterator last(std::next(trailing_of(i)));
+
+    return size_type(std::distance(first, last));
+}
+
+/**************************************************************************************************/
+
+template <class T, class A, bool Counted>
+void forest<T, A, Counted>::clear() {
+    /*
+        Everything is going, so there is no need to keep the links (or the counts) consistent
+        while we go. Nodes are destroyed on their trailing edge, once all their children have
+        been, and the iterator has already stepped off a node by the time it is destroyed.
+    */
+    iterator first(begin());
+    iterator last(end());
+
+    while (first != last) {
+        node_t* node(first._node);
+        const bool trailing(is_trailing(first));
+        ++first;
+        if (trailing) destroy_node(node);
+    }
+
+    for (auto edge : {forest_edge::trailing, forest_edge::leading}) {
+        _tail.link(edge, node_t::prior_s) = tail();
+        _tail.link(edge, node_t::next_s) = tail();
+    }
+
+    _size = 0;
+    _tail_counts = counts_t{nullptr, 0, 0};
+
+    assert(empty());
+}
+
+/**************************************************************************************************/
+
+template <class T, class A, bool Counted>
+typename forest<T, A, Counted>::iterator forest<T, A, Counted>::erase(const iterator& first,
+                                                                      const iterator& last) {
     difference_type stack_depth(0);
     iterator position(first);
 
@@ -954,8 +1106,8 @@ typename forest<T>::iterator forest<T>::erase(const iterator& first, const itera
 
 /**************************************************************************************************/
 
-template <class T>
-typename forest<T>::iterator forest<T>::erase(const iterator& position) {
+template <class T, class A, bool Counted>
+typename forest<T, A, Counted>::iterator forest<T, A, Counted>::erase(const iterator& position) {
     /*
         NOTE (sparent) : After the first call to set_next() the invariants of the forest are
         violated and we can't determing leading/trailing if we navigate from the affected node.
@@ -964,6 +1116,21 @@ typename forest<T>::iterator forest<T>::erase(const iterator& position) {
 
     if (size_valid()) --_size;
 
+    if constexpr (Counted) {
+        // The children (if any) take this node's place in its parent.
+        node_t* node(position._node);
+        node_t* parent(counts(node)._parent);
+
+        for (child_iterator first(child_begin(position)), last(child_end(position)); first != last;
+             ++first) {
+            counts(first.base()._node)._parent = parent;
+        }
+
+        counts(parent)._children += counts(node)._children;
+        --counts(parent)._children;
+        remove_weight(parent, 1);
+    }
+
     iterator leading_prior(std::prev(leading_of(position)));
     iterator leading_next(std::next(leading_of(position)));
     iterator trailing_prior(std::prev(trailing_of(position)));
@@ -976,33 +1143,36 @@ typename forest<T>::iterator forest<T>::erase(const iterator& position) {
         unsafe::set_next(leading_prior, trailing_next);
     }
 
-    delete position._node;
+    destroy_node(position._node);
 
     return is_leading(position) ? std::next(leading_prior) : trailing_next;
 }
 
 /**************************************************************************************************/
 
-template <class T>
-typename forest<T>::iterator forest<T>::splice(iterator position, forest<T>& x) {
+template <class T, class A, bool Counted>
+typename forest<T, A, Counted>::iterator forest<T, A, Counted>::splice(iterator position,
+                                                                       forest& x) {
     return splice(position, x, child_iterator(x.begin()), child_iterator(x.end()),
                   x.size_valid() ? x.size() : 0);
 }
 
 /**************************************************************************************************/
 
-template <class T>
-typename forest<T>::iterator forest<T>::splice(iterator position, forest<T>& x, iterator i) {
+template <class T, class A, bool Counted>
+typename forest<T, A, Counted>::iterator forest<T, A, Counted>::splice(iterator position,
+                                                                       forest& x,
+                                                                       iterator i) {
     i.edge() = forest_edge::leading;
     return splice(position, x, child_iterator(i), ++child_iterator(i), has_children(i) ? 0 : 1);
 }
 
 /**************************************************************************************************/
 
-template <class T>
-typename forest<T>::iterator forest<T>::insert(iterator pos,
-                                               const_child_iterator f,
-                                               const_child_iterator l) {
+template <class T, class A, bool Counted>
+typename forest<T, A, Counted>::iterator forest<T, A, Counted>::insert(iterator pos,
+                                                                       const_child_iterator f,
+                                                                       const_child_iterator l) {
     for (const_iterator first(f.base()), last(l.base()); first != last; ++first, ++pos) {
         if (is_leading(first)) pos = insert(pos, *first);
     }
@@ -1012,11 +1182,13 @@ typename forest<T>::iterator forest<T>::insert(iterator pos,
 
 /**************************************************************************************************/
 
-template <class T>
-typename forest<T>::iterator forest<T>::splice(
-    iterator pos, forest<T>& x, child_iterator first, child_iterator last, size_type count) {
+template <class T, class A, bool Counted>
+typename forest<T, A, Counted>::iterator forest<T, A, Counted>::splice(
+    iterator pos, forest& x, child_iterator first, child_iterator last, size_type count) {
     if (first == last || first.base() == pos) return pos;
 
+    assert(&x == this || _alloc == x._alloc); // nodes must be freed by the allocator that made them
+
     if (&x != this) {
         if (count) {
             if (size_valid()) _size += count;
@@ -1027,6 +1199,25 @@ typename forest<T>::iterator forest<T>::splice(
         }
     }
 
+    if constexpr (Counted) {
+        node_t* from(x.counts(first.base()._node)._parent);
+        node_t* to(parent_at(pos));
+        size_type children(0);
+        size_type weight(0);
+
+        for (child_iterator i(first); i != last; ++i) {
+            auto& c(x.counts(i.base()._node));
+            c._parent = to;
+            ++children;
+            weight += c._weight;
+        }
+
+        x.counts(from)._children -= children;
+        x.remove_weight(from, weight);
+        counts(to)._children += children;
+        add_weight(to, weight);
+    }
+
     iterator back(std::prev(last.base()));
 
     unsafe::set_next(std::prev(first), last);
@@ -1039,20 +1230,20 @@ typename forest<T>::iterator forest<T>::splice(
 
 /**************************************************************************************************/
 
-template <class T>
-typename forest<T>::iterator forest<T>::splice(iterator pos,
-                                               forest<T>& x,
-                                               child_iterator first,
-                                               child_iterator last) {
+template <class T, class A, bool Counted>
+typename forest<T, A, Counted>::iterator forest<T, A, Counted>::splice(iterator pos,
+                                                                       forest& x,
+                                                                       child_iterator first,
+                                                                       child_iterator last) {
     return splice(pos, x, first, last, 0);
 }
 
 /**************************************************************************************************/
 
-template <class T>
-typename forest<T>::iterator forest<T>::insert_parent(child_iterator first,
-                                                      child_iterator last,
-                                                      const T& x) {
+template <class T, class A, bool Counted>
+typename forest<T, A, Counted>::iterator forest<T, A, Counted>::insert_parent(child_iterator first,
+                                                                              child_iterator last,
+                                                                              const T& x) {
     iterator result(insert(last.base(), x));
     if (first == last) return result;
     splice(trailing_of(result), *this, first, child_iterator(result));
@@ -1061,8 +1252,8 @@ typename forest<T>::iterator forest<T>::insert_parent(child_iterator first,
 
 /**************************************************************************************************/
 
-template <class T>
-void forest<T>::reverse(child_iterator first, child_iterator last) {
+template <class T, class A, bool Counted>
+void forest<T, A, Counted>::reverse(child_iterator first, child_iterator last) {
     iterator prior(first.base());
     --prior;
     first = unsafe::reverse_nodes(first, last);